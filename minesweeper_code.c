@@ -1,10 +1,27 @@
 #define _CRT_SECURE_NO_DEPRECATE
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // clock_gettime и потоки POSIX при строгом -std=c11
+#endif
 #include <locale.h>
 #include <stdio.h>
 #include <stdlib.h> // работа с памятью, генерация случайных чисел, exit, malloc, free
 #include <string.h> // работа со строками и памятью (memset, memcpy, strlen и т.д.)
 #include <time.h>
 #include <stdbool.h> // тип bool, значения true/false
+#include <stdint.h>  // uint64_t для генератора случайных чисел
+#include <inttypes.h> // PRIu64/SCNu64: ввод и вывод 64-битного seed
+#include <math.h>    // log, log1p, floor: геометрические пропуски при расстановке мин
+
+#ifdef _WIN32
+#include <windows.h> // потоки и атомарные операции Win32
+#else
+#include <pthread.h> // потоки POSIX
+#include <unistd.h>  // sysconf: число процессоров
+#include <fcntl.h>   // open
+#include <sys/mman.h> // mmap: загрузка двоичных полей без копирования
+#include <sys/stat.h> // fstat
+#include <dirent.h>   // opendir: проверка каталога с полями
+#endif
 
 /* Максимальное число попыток найти решение.
    Технически — это просто практический лимит, чтобы программа не зацикливалась
@@ -12,6 +29,223 @@
 */
 #define MAX_ATTEMPTS 1000
 
+/* Начиная с такого числа клеток поле хранится в компактном представлении
+   (1 бит на мину, 4 бита на счётчик) — так в ту же память помещаются поля
+   на порядок больше.
+*/
+#define PACKED_MIN_CELLS (4 * 1024 * 1024)
+
+/* Стандартные размеры полей (строки, столбцы). Для них compute_counts и
+   solver_ctx_run (а через него check_solvability_ctx и вся генерация) выбирают
+   специализированные версии с размерами-константами (см. DEFINE_COUNTS_PRESET,
+   DEFINE_SOLVER_PRESET); остальные размеры идут по общему коду. Новый размер
+   добавляется одной строкой X(R, C).
+*/
+#define FIELD_PRESETS(X) \
+    X(8, 8)              \
+    X(9, 9)              \
+    X(16, 16)            \
+    X(16, 30)
+
+/* ===================================================================
+   Платформенные обёртки
+   =================================================================== */
+
+   /* Минимальная обёртка над потоками, синхронизацией, атомарными операциями
+      и монотонными часами (Win32 / POSIX).
+   */
+#ifdef _WIN32
+typedef HANDLE thread_handle;
+typedef DWORD(WINAPI* thread_proc)(void*);
+#define THREAD_PROC(name) DWORD WINAPI name(void* arg)
+#define THREAD_RETURN return 0
+
+static bool thread_start(thread_handle* t, thread_proc proc, void* arg) {
+    *t = CreateThread(NULL, 0, proc, arg, 0, NULL);
+    return *t != NULL;
+}
+static void thread_join(thread_handle t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+static inline long atomic_fetch_inc(volatile long* p) { return InterlockedIncrement(p) - 1; }
+static inline long atomic_load(volatile long* p) { return InterlockedCompareExchange(p, 0, 0); }
+static inline bool atomic_cas(volatile long* p, long expected, long desired) {
+    return InterlockedCompareExchange(p, desired, expected) == expected;
+}
+static int cpu_count(void) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+}
+
+typedef CRITICAL_SECTION mutex_handle;
+typedef CONDITION_VARIABLE cond_handle;
+static void mutex_init(mutex_handle* m) { InitializeCriticalSection(m); }
+static void mutex_destroy(mutex_handle* m) { DeleteCriticalSection(m); }
+static void mutex_lock(mutex_handle* m) { EnterCriticalSection(m); }
+static void mutex_unlock(mutex_handle* m) { LeaveCriticalSection(m); }
+static void cond_init(cond_handle* c) { InitializeConditionVariable(c); }
+static void cond_destroy(cond_handle* c) { (void)c; }
+static void cond_wait(cond_handle* c, mutex_handle* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void cond_signal(cond_handle* c) { WakeConditionVariable(c); }
+static void cond_broadcast(cond_handle* c) { WakeAllConditionVariable(c); }
+
+/* now_seconds — монотонные часы, секунды. */
+static double now_seconds(void) {
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)freq.QuadPart;
+}
+#else
+typedef pthread_t thread_handle;
+typedef void* (*thread_proc)(void*);
+#define THREAD_PROC(name) void* name(void* arg)
+#define THREAD_RETURN return NULL
+
+static bool thread_start(thread_handle* t, thread_proc proc, void* arg) {
+    return pthread_create(t, NULL, proc, arg) == 0;
+}
+static void thread_join(thread_handle t) {
+    pthread_join(t, NULL);
+}
+static inline long atomic_fetch_inc(volatile long* p) { return __atomic_fetch_add(p, 1, __ATOMIC_SEQ_CST); }
+static inline long atomic_load(volatile long* p) { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+static inline bool atomic_cas(volatile long* p, long expected, long desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+static int cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+typedef pthread_mutex_t mutex_handle;
+typedef pthread_cond_t cond_handle;
+static void mutex_init(mutex_handle* m) { pthread_mutex_init(m, NULL); }
+static void mutex_destroy(mutex_handle* m) { pthread_mutex_destroy(m); }
+static void mutex_lock(mutex_handle* m) { pthread_mutex_lock(m); }
+static void mutex_unlock(mutex_handle* m) { pthread_mutex_unlock(m); }
+static void cond_init(cond_handle* c) { pthread_cond_init(c, NULL); }
+static void cond_destroy(cond_handle* c) { pthread_cond_destroy(c); }
+static void cond_wait(cond_handle* c, mutex_handle* m) { pthread_cond_wait(c, m); }
+static void cond_signal(cond_handle* c) { pthread_cond_signal(c); }
+static void cond_broadcast(cond_handle* c) { pthread_cond_broadcast(c); }
+
+/* now_seconds — монотонные часы, секунды. */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
+/* atomic_min — атомарно записывает в *p значение v, если оно меньше текущего. */
+static inline void atomic_min(volatile long* p, long v) {
+    long cur = atomic_load(p);
+    while (v < cur && !atomic_cas(p, cur, v)) cur = atomic_load(p);
+}
+
+/* MS_FORCE_INLINE — обязательная подстановка: общий код солвера с шириной-параметром
+   подставляется в специализации FIELD_PRESETS, где ширина — константа. */
+#ifdef _MSC_VER
+#define MS_FORCE_INLINE __forceinline
+#else
+#define MS_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+/* ===================================================================
+   Статистика горячих путей (только при сборке с MS_STATS)
+   =================================================================== */
+
+   /*
+     Чтобы понять, куда уходит время генерации, программу можно собрать с
+     макросом MS_STATS (/D MS_STATS или -DMS_STATS). Тогда считаются:
+       attempts        — попытки генерации поля
+       solver_runs     — запуски солвера из стартовой клетки
+       rounds          — циклы распространения (обработки очереди до опустошения)
+       cells_examined  — клетки, взятые из очереди солвера
+       rule_a, rule_b  — срабатывания правил A (всё мины) и B (всё безопасно)
+       rule_pair       — выводы по паре соседних чисел (правило C)
+       repair_moves    — переносы мин при генерации с исправлениями (--repair)
+       queue_pushes    — постановки клеток в очередь солвера
+       bfs_pushes      — клетки, пройденные при разметке нулевых областей
+     и время фаз по монотонным часам (генерация включает подсчёт счётчиков).
+     Каждый поток копит счётчики у себя (без синхронизации в горячих циклах) и
+     сливает их в общий итог stats_flush() при завершении работы.
+     Без MS_STATS все макросы STAT_* пустые и ничего не стоят.
+   */
+#ifdef MS_STATS
+typedef struct {
+    long long attempts, solver_runs, rounds, cells_examined;
+    long long rule_a, rule_b, rule_pair, queue_pushes, bfs_pushes, repair_moves;
+    double t_generate, t_counts, t_solve, t_validate; /* секунды */
+} SolverStats;
+
+#ifdef _MSC_VER
+#define MS_THREAD_LOCAL __declspec(thread)
+#else
+#define MS_THREAD_LOCAL _Thread_local
+#endif
+
+static MS_THREAD_LOCAL SolverStats tls_stats; /* счётчики текущего потока */
+static SolverStats total_stats;               /* слитые счётчики всех потоков */
+static volatile long stats_lock;              /* 0 — свободно */
+
+#define STAT_ADD(name, v) (tls_stats.name += (v))
+#define STAT_TIME_BEGIN(var) double var = now_seconds()
+#define STAT_TIME_END(name, var) (tls_stats.name += now_seconds() - (var))
+
+/* stats_flush — переносит счётчики текущего потока в общий итог. */
+static void stats_flush(void) {
+    while (!atomic_cas(&stats_lock, 0, 1)) {}
+    total_stats.attempts += tls_stats.attempts;
+    total_stats.solver_runs += tls_stats.solver_runs;
+    total_stats.rounds += tls_stats.rounds;
+    total_stats.cells_examined += tls_stats.cells_examined;
+    total_stats.rule_a += tls_stats.rule_a;
+    total_stats.rule_b += tls_stats.rule_b;
+    total_stats.rule_pair += tls_stats.rule_pair;
+    total_stats.repair_moves += tls_stats.repair_moves;
+    total_stats.queue_pushes += tls_stats.queue_pushes;
+    total_stats.bfs_pushes += tls_stats.bfs_pushes;
+    total_stats.t_generate += tls_stats.t_generate;
+    total_stats.t_counts += tls_stats.t_counts;
+    total_stats.t_solve += tls_stats.t_solve;
+    total_stats.t_validate += tls_stats.t_validate;
+    memset(&tls_stats, 0, sizeof(tls_stats));
+    atomic_cas(&stats_lock, 1, 0);
+}
+
+/* stats_take — возвращает накопленный итог (вместе со счётчиками текущего потока) и обнуляет его. */
+SolverStats stats_take(void) {
+    stats_flush();
+    while (!atomic_cas(&stats_lock, 0, 1)) {}
+    SolverStats s = total_stats;
+    memset(&total_stats, 0, sizeof(total_stats));
+    atomic_cas(&stats_lock, 1, 0);
+    return s;
+}
+
+/* stats_print — печатает итог в поток out. Время фаз суммируется по всем потокам. */
+static void stats_print(FILE* out, const SolverStats* s) {
+    fprintf(out, "Статистика: попыток %lld, запусков солвера %lld, циклов распространения %lld\n",
+        s->attempts, s->solver_runs, s->rounds);
+    fprintf(out, "  клеток из очереди %lld, постановок в очередь %lld, обход нулевых областей %lld\n",
+        s->cells_examined, s->queue_pushes, s->bfs_pushes);
+    fprintf(out, "  правило A: %lld, правило B: %lld, правило C (пары): %lld, переносов мин: %lld\n",
+        s->rule_a, s->rule_b, s->rule_pair, s->repair_moves);
+    fprintf(out, "  время (сумма по потокам), мс: генерация %.3f (из них счётчики %.3f), "
+        "решаемость %.3f, проверка %.3f\n",
+        s->t_generate * 1e3, s->t_counts * 1e3, s->t_solve * 1e3, s->t_validate * 1e3);
+}
+#else
+#define STAT_ADD(name, v) ((void)0)
+#define STAT_TIME_BEGIN(var) ((void)0)
+#define STAT_TIME_END(name, var) ((void)0)
+#define stats_flush() ((void)0)
+#endif
+
 /* ===================================================================
    Структура данных для поля "Сапёр"
    =================================================================== */
@@ -19,13 +253,20 @@
    /* Field хранит:
       - rows, cols : размеры поля
       - mines      : текущее число расставленных мин
-      - is_mine    : линейный массив длины rows*cols; 1 = мина, 0 = нет
-      - count      : линейный массив длины rows*cols; count[i] = число мин вокруг клетки i
+      - packed     : компактное представление (см. ниже)
+      - is_mine    : флаги мин клеток 0..rows*cols-1; 1 = мина, 0 = нет
+      - count      : count[i] = число мин вокруг клетки i
+
+      Обычное представление — по байту на клетку в каждом массиве.
+      Компактное (packed) — для очень больших полей: is_mine хранит 1 бит на клетку,
+      count — 4 бита на клетку (значения 0..8). Читать и писать клетки в обоих
+      случаях следует через field_mine/field_count/field_set_mine/field_set_count.
    */
 typedef struct {
     int rows;
     int cols;
     int mines;
+    bool packed;
     unsigned char* is_mine;
     unsigned char* count;
 } Field;
@@ -39,15 +280,66 @@ static inline int IDX(const Field* f, int r, int c) {
     return r * f->cols + c;
 }
 
+/* -------------------------------------------------------------------
+   Битовые множества: 1 бит на клетку.
+   ------------------------------------------------------------------- */
+static inline size_t bitset_bytes(size_t n) {
+    return (n + 7) / 8;
+}
+static inline int bit_get(const unsigned char* b, size_t i) {
+    return (b[i >> 3] >> (i & 7)) & 1;
+}
+static inline void bit_set(unsigned char* b, size_t i) {
+    b[i >> 3] |= (unsigned char)(1u << (i & 7));
+}
+static inline void bit_clear(unsigned char* b, size_t i) {
+    b[i >> 3] &= (unsigned char)~(1u << (i & 7));
+}
+
+/* -------------------------------------------------------------------
+   Доступ к клеткам поля независимо от представления.
+   ------------------------------------------------------------------- */
+static inline int field_mine(const Field* f, int i) {
+    return f->packed ? bit_get(f->is_mine, i) : f->is_mine[i];
+}
+
+static inline int field_count(const Field* f, int i) {
+    if (!f->packed) return f->count[i];
+    return (f->count[i >> 1] >> ((i & 1) * 4)) & 0x0F;
+}
+
+static inline void field_set_mine(Field* f, int i, int v) {
+    if (!f->packed) f->is_mine[i] = (unsigned char)(v != 0);
+    else if (v) bit_set(f->is_mine, i);
+    else bit_clear(f->is_mine, i);
+}
+
+static inline void field_set_count(Field* f, int i, int v) {
+    if (!f->packed) { f->count[i] = (unsigned char)v; return; }
+    unsigned char* b = &f->count[i >> 1];
+    int sh = (i & 1) * 4;
+    *b = (unsigned char)((*b & ~(0x0F << sh)) | ((v & 0x0F) << sh));
+}
+
+/* размеры массивов is_mine и count в байтах */
+static inline size_t field_mine_bytes(const Field* f) {
+    size_t n = (size_t)f->rows * f->cols;
+    return f->packed ? bitset_bytes(n) : n;
+}
+static inline size_t field_count_bytes(const Field* f) {
+    size_t n = (size_t)f->rows * f->cols;
+    return f->packed ? (n + 1) / 2 : n;
+}
+
 /* ===================================================================
    Управление памятью поля
    =================================================================== */
 
-   /* field_create
-      - Выделяет память и инициализирует структуру поля.
+   /* field_create_ex
+      - Выделяет память и инициализирует структуру поля в выбранном представлении.
       - Возвращает NULL при ошибке.
    */
-Field* field_create(int rows, int cols) {
+Field* field_create_ex(int rows, int cols, bool packed) {
     if (rows <= 0 || cols <= 0) return NULL;
     Field* f = (Field*)malloc(sizeof(Field));
     if (!f) return NULL;
@@ -55,9 +347,9 @@ Field* field_create(int rows, int cols) {
     f->rows = rows;
     f->cols = cols;
     f->mines = 0;
-    int n = rows * cols;
-    f->is_mine = (unsigned char*)calloc(n, sizeof(unsigned char)); // нули
-    f->count = (unsigned char*)calloc(n, sizeof(unsigned char));   // нули
+    f->packed = packed;
+    f->is_mine = (unsigned char*)calloc(field_mine_bytes(f), sizeof(unsigned char)); // нули
+    f->count = (unsigned char*)calloc(field_count_bytes(f), sizeof(unsigned char));  // нули
     if (!f->is_mine || !f->count) { // проверка успешности выделения
         free(f->is_mine);
         free(f->count);
@@ -67,6 +359,11 @@ Field* field_create(int rows, int cols) {
     return f;
 }
 
+/* field_create — поле в обычном представлении (байт на клетку). */
+Field* field_create(int rows, int cols) {
+    return field_create_ex(rows, cols, false);
+}
+
 /* field_free
    - Освобождает память структуры и её массивов.
    - Безопасно вызывать с NULL.
@@ -84,9 +381,8 @@ void field_free(Field* f) {
 */
 void field_clear(Field* f) {
     if (!f) return;
-    int n = f->rows * f->cols;
-    memset(f->is_mine, 0, n * sizeof(unsigned char));
-    memset(f->count, 0, n * sizeof(unsigned char));
+    memset(f->is_mine, 0, field_mine_bytes(f));
+    memset(f->count, 0, field_count_bytes(f));
     f->mines = 0;
 }
 
@@ -94,363 +390,4902 @@ void field_clear(Field* f) {
    Подсчёт счётчиков (чисел в клетках)
    =================================================================== */
 
+   /* -------------------------------------------------------------------
+      Векторное ядро подсчёта соседей.
+
+      Число мин вокруг клетки (r,c) — это сумма 3x3 окна минус сама клетка.
+      Считаем его построчно:
+        1) vsum[c] = up[c] + mid[c] + down[c]       (вертикальная сумма, 0..3)
+        2) out[c]  = vsum[c-1] + vsum[c] + vsum[c+1] - mid[c]
+        3) у мин out[c] = 0.
+      Обе операции — сложения сдвинутых копий строк байтов, поэтому их удобно
+      делать по 16 (SSE2) или 32 (AVX2) клеток за раз; хвост строки и платформы
+      без SIMD обрабатывает скалярный код. Строки за краем поля — нулевые,
+      vsum дополнен нулями с обеих сторон, так что проверок границ нет.
+      is_mine должен содержать только 0 и 1.
+      Сборка с -DMS_NO_SIMD оставляет только скалярный код (для сверки путей).
+      ------------------------------------------------------------------- */
+#if defined(__AVX2__) && !defined(MS_NO_SIMD)
+#include <immintrin.h>
+#define MS_SIMD_AVX2 1
+#endif
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) \
+    && !defined(MS_NO_SIMD)
+#include <emmintrin.h>
+#define MS_SIMD_SSE2 1
+#endif
+
+/* count_row_kernel
+   - up, mid, down : строки is_mine длины C (up/down — нулевая строка за краем поля)
+   - vsum          : рабочий буфер длины C + 2
+   - out           : результат — число соседних мин (0 для мин)
+*/
+static void count_row_kernel(const unsigned char* up, const unsigned char* mid,
+    const unsigned char* down, unsigned char* vsum, unsigned char* out, int C) {
+    unsigned char* v = vsum + 1; /* v[-1] и v[C] — нулевые поля */
+    int c = 0;
+    vsum[0] = 0;
+    vsum[C + 1] = 0;
+
+    /* 1) вертикальные суммы */
+#ifdef MS_SIMD_AVX2
+    for (; c + 32 <= C; c += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(up + c));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(mid + c));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(down + c));
+        _mm256_storeu_si256((__m256i*)(v + c), _mm256_add_epi8(_mm256_add_epi8(a, b), d));
+    }
+#endif
+#ifdef MS_SIMD_SSE2
+    for (; c + 16 <= C; c += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(up + c));
+        __m128i b = _mm_loadu_si128((const __m128i*)(mid + c));
+        __m128i d = _mm_loadu_si128((const __m128i*)(down + c));
+        _mm_storeu_si128((__m128i*)(v + c), _mm_add_epi8(_mm_add_epi8(a, b), d));
+    }
+#endif
+    for (; c < C; ++c) v[c] = (unsigned char)(up[c] + mid[c] + down[c]);
+
+    /* 2) горизонтальные суммы и 3) обнуление у мин */
+    c = 0;
+#ifdef MS_SIMD_AVX2
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        for (; c + 32 <= C; c += 32) {
+            __m256i l = _mm256_loadu_si256((const __m256i*)(v + c - 1));
+            __m256i m = _mm256_loadu_si256((const __m256i*)(v + c));
+            __m256i r = _mm256_loadu_si256((const __m256i*)(v + c + 1));
+            __m256i self = _mm256_loadu_si256((const __m256i*)(mid + c));
+            __m256i sum = _mm256_sub_epi8(_mm256_add_epi8(_mm256_add_epi8(l, m), r), self);
+            __m256i safe = _mm256_cmpeq_epi8(self, zero); /* 0xFF там, где не мина */
+            _mm256_storeu_si256((__m256i*)(out + c), _mm256_and_si256(sum, safe));
+        }
+    }
+#endif
+#ifdef MS_SIMD_SSE2
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (; c + 16 <= C; c += 16) {
+            __m128i l = _mm_loadu_si128((const __m128i*)(v + c - 1));
+            __m128i m = _mm_loadu_si128((const __m128i*)(v + c));
+            __m128i r = _mm_loadu_si128((const __m128i*)(v + c + 1));
+            __m128i self = _mm_loadu_si128((const __m128i*)(mid + c));
+            __m128i sum = _mm_sub_epi8(_mm_add_epi8(_mm_add_epi8(l, m), r), self);
+            __m128i safe = _mm_cmpeq_epi8(self, zero);
+            _mm_storeu_si128((__m128i*)(out + c), _mm_and_si128(sum, safe));
+        }
+    }
+#endif
+    for (; c < C; ++c)
+        out[c] = mid[c] ? 0 : (unsigned char)(v[c - 1] + v[c] + v[c + 1] - mid[c]);
+}
+
+/* CountRows — буферы для построчного применения count_row_kernel. */
+typedef struct {
+    unsigned char* zero;  /* нулевая строка для краёв поля */
+    unsigned char* vsum;  /* вертикальные суммы, C + 2 */
+    unsigned char* row;   /* результат для одной строки */
+    unsigned char* mines; /* 3 распакованные строки мин (только для packed) */
+} CountRows;
+
+static bool count_rows_init(CountRows* b, const Field* f) {
+    int C = f->cols;
+    b->zero = (unsigned char*)calloc(C, sizeof(unsigned char));
+    b->vsum = (unsigned char*)malloc((C + 2) * sizeof(unsigned char));
+    b->row = (unsigned char*)malloc(C * sizeof(unsigned char));
+    b->mines = f->packed ? (unsigned char*)malloc(3 * (size_t)C * sizeof(unsigned char)) : NULL;
+    if (!b->zero || !b->vsum || !b->row || (f->packed && !b->mines)) {
+        free(b->zero); free(b->vsum); free(b->row); free(b->mines);
+        return false;
+    }
+    return true;
+}
+
+static void count_rows_free(CountRows* b) {
+    free(b->zero);
+    free(b->vsum);
+    free(b->row);
+    free(b->mines);
+}
+
+/* field_mine_row — строка r флагов мин в виде байтов 0/1. */
+static const unsigned char* field_mine_row(const Field* f, int r, unsigned char* buf) {
+    int C = f->cols;
+    if (!f->packed) return f->is_mine + (size_t)r * C;
+    size_t base = (size_t)r * C;
+    for (int c = 0; c < C; ++c) buf[c] = (unsigned char)bit_get(f->is_mine, base + c);
+    return buf;
+}
+
+/* count_field_row — считает соседей для строки r поля f в out (длина cols). */
+static void count_field_row(const Field* f, CountRows* b, int r, unsigned char* out) {
+    int C = f->cols;
+    const unsigned char* mid = field_mine_row(f, r, b->mines + C);
+    const unsigned char* up = (r > 0) ? field_mine_row(f, r - 1, b->mines) : b->zero;
+    const unsigned char* down = (r < f->rows - 1) ? field_mine_row(f, r + 1, b->mines + 2 * C) : b->zero;
+    count_row_kernel(up, mid, down, b->vsum, out, C);
+}
+
+/* DEFINE_COUNTS_PRESET
+   - compute_counts для поля PR x PC в обычном представлении: мины копируются
+     в массив на стеке с нулевой рамкой, и число клетки — сумма восьми соседей
+     по постоянным смещениям, без буферов из кучи и проверок краёв.
+   - Ширина рабочего массива округлена вверх до 16: у циклов с постоянным
+     числом итераций, кратным ширине вектора, нет хвоста, и компилятор
+     векторизует их уже на -O2. Лишние столбцы нулевые и не копируются в поле.
+*/
+#define DEFINE_COUNTS_PRESET(PR, PC)                                               \
+static void compute_counts_##PR##x##PC(Field* f) {                                \
+    enum { CW = (PC + 15) / 16 * 16, W = CW + 2 };                                 \
+    unsigned char m[(PR + 2) * W], row[CW];                                        \
+    memset(m, 0, sizeof(m));                                                       \
+    for (int r = 0; r < PR; ++r)                                                   \
+        memcpy(m + (r + 1) * W + 1, f->is_mine + r * PC, PC);                      \
+    for (int r = 0; r < PR; ++r) {                                                 \
+        const unsigned char* p = m + (r + 1) * W + 1;                              \
+        for (int c = 0; c < CW; ++c) {                                             \
+            unsigned char n = (unsigned char)(p[c - W - 1] + p[c - W] + p[c - W + 1] \
+                + p[c - 1] + p[c + 1] + p[c + W - 1] + p[c + W] + p[c + W + 1]);   \
+            row[c] = p[c] ? 0 : n;                                                 \
+        }                                                                          \
+        memcpy(f->count + r * PC, row, PC);                                        \
+    }                                                                              \
+}
+FIELD_PRESETS(DEFINE_COUNTS_PRESET)
+#undef DEFINE_COUNTS_PRESET
+
+/* compute_counts_preset — считает поле стандартного размера специализированной
+   версией; false, если размер не из FIELD_PRESETS или поле компактное. */
+static bool compute_counts_preset(Field* f) {
+    if (f->packed) return false;
+#define COUNTS_PRESET_CASE(PR, PC) \
+    if (f->rows == PR && f->cols == PC) { compute_counts_##PR##x##PC(f); return true; }
+    FIELD_PRESETS(COUNTS_PRESET_CASE)
+#undef COUNTS_PRESET_CASE
+    return false;
+}
+
    /* compute_counts
       - Для каждой клетки, если она не мина, вычисляет количество мин среди 8 соседей.
-      - Результат записывается в f->count.
+      - Результат записывается в f->count. Считается построчно векторным ядром,
+        стандартные размеры — специализированными версиями (compute_counts_preset).
    */
 void compute_counts(Field* f) {
     if (!f) return;
-    int R = f->rows, C = f->cols;
-
-    for (int r = 0; r < R; ++r) {
-        for (int c = 0; c < C; ++c) {
-            int i = IDX(f, r, c);
-            if (f->is_mine[i]) { f->count[i] = 0; continue; }
-
-            int cnt = 0; // считаем соседние мины
-            for (int dr = -1; dr <= 1; ++dr)
-                for (int dc = -1; dc <= 1; ++dc) {
-                    if (dr == 0 && dc == 0) continue; // сама клетка не считается
-                    int rr = r + dr, cc = c + dc;
-                    if (rr >= 0 && rr < R && cc >= 0 && cc < C)
-                        if (f->is_mine[IDX(f, rr, cc)]) ++cnt;
-                }
-            f->count[i] = (unsigned char)cnt;
+    STAT_TIME_BEGIN(t0);
+    if (compute_counts_preset(f)) {
+        STAT_TIME_END(t_counts, t0);
+        return;
+    }
+    CountRows b;
+    if (!count_rows_init(&b, f)) return;
+    int C = f->cols;
+    for (int r = 0; r < f->rows; ++r) {
+        if (!f->packed) {
+            count_field_row(f, &b, r, f->count + (size_t)r * C);
+            continue;
         }
+        count_field_row(f, &b, r, b.row);
+        for (int c = 0; c < C; ++c) field_set_count(f, IDX(f, r, c), b.row[c]);
     }
+    count_rows_free(&b);
+    STAT_TIME_END(t_counts, t0);
 }
 
 /* ===================================================================
    Генерация поля
    =================================================================== */
 
-   /* generate_by_probability
-      - Для каждой клетки кидает случайное число 0..99 и, если < percent,
-        устанавливает там мину.
+   /* Rng — собственный генератор случайных чисел xoshiro256**.
+      В отличие от глобального rand(), у каждого потока генерации свой поток
+      чисел, и его можно воспроизвести по 64-битному начальному значению (seed).
+   */
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+/* splitmix64 — перемешивает 64-битное значение; используется для заполнения
+   состояния xoshiro и для вывода независимых seed'ов из одного. */
+static inline uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* rng_seed — задаёт начальное состояние генератора по seed. */
+static inline void rng_seed(Rng* g, uint64_t seed) {
+    for (int k = 0; k < 4; ++k) g->s[k] = splitmix64(&seed);
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/* rng_next — следующее 64-битное случайное число (xoshiro256**). */
+static inline uint64_t rng_next(Rng* g) {
+    uint64_t* s = g->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+/* rng_double — равномерное случайное число из [0, 1) с 53 значащими битами. */
+static inline double rng_double(Rng* g) {
+    return (double)(rng_next(g) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* rng_below — равномерное целое из [0, n), n > 0, без смещения: значения из
+   неполного последнего "круга" по модулю n отбрасываются. */
+static inline uint64_t rng_below(Rng* g, uint64_t n) {
+    uint64_t limit = (0 - n) % n; /* 2^64 mod n */
+    for (;;) {
+        uint64_t x = rng_next(g);
+        if (x >= limit) return x % n;
+    }
+}
+
+/* derive_seed — независимый seed номер k, выведенный из общего master_seed. */
+static inline uint64_t derive_seed(uint64_t master_seed, uint64_t k) {
+    uint64_t x = master_seed ^ (k * 0xD1B54A32D192ED03ULL);
+    return splitmix64(&x);
+}
+
+/* rng_seed_attempt
+   - Независимый поток чисел для попытки номер attempt при общем master_seed.
+   - Поле попытки зависит только от (master_seed, attempt), поэтому результат
+     не зависит от того, какой поток и в каком порядке её выполнил.
+*/
+static inline void rng_seed_attempt(Rng* g, uint64_t master_seed, int attempt) {
+    rng_seed(g, derive_seed(master_seed, (uint64_t)attempt));
+}
+
+   /* MineSampler — последовательный выбор мин для generate_by_probability.
+      Выдаёт номера клеток-мин по возрастанию, не храня само поле, поэтому
+      той же выборкой пользуется потоковая генерация (--stream): при одинаковом
+      состоянии Rng получаются одни и те же мины.
+      - При плотности до 50% мины ставятся выборкой с геометрическими пропусками:
+        расстояние до следующей мины имеет геометрическое распределение, поэтому
+        на поле тратится O(mines) случайных чисел, а не O(cells).
+        При большей плотности дешевле просто бросить число на каждую клетку.
+   */
+typedef struct {
+    Rng* rng;
+    int64_t n;          /* число клеток */
+    int64_t pos;        /* последняя выданная клетка (-1 в начале, n — выборка кончилась) */
+    double p;           /* вероятность мины 0..1 */
+    double inv_log_q;   /* 1 / ln(1 - p) для пропусков */
+    uint64_t threshold; /* порог сравнения: P(next < threshold) = p */
+} MineSampler;
+
+static inline void mine_sampler_init(MineSampler* m, Rng* rng, double percent, int64_t n) {
+    if (!(percent > 0)) percent = 0; /* заодно отсекает NaN */
+    if (percent > 100) percent = 100;
+    m->rng = rng;
+    m->n = n;
+    m->pos = -1;
+    m->p = percent / 100.0;
+    m->inv_log_q = (m->p > 0 && m->p < 1.0) ? 1.0 / log1p(-m->p) : 0.0;
+    m->threshold = (m->p > 0.5 && m->p < 1.0) ? (uint64_t)(m->p * 18446744073709551616.0) : 0;
+}
+
+/* mine_sampler_next — номер следующей мины или -1, если мин больше нет. */
+static inline int64_t mine_sampler_next(MineSampler* m) {
+    if (m->pos >= m->n - 1 || m->p <= 0) { m->pos = m->n; return -1; }
+    if (m->p >= 1.0) return ++m->pos;
+    if (m->p <= 0.5) {
+        /* пропуск = floor(ln(u) / ln(1 - p)), u из (0, 1] */
+        double skip = floor(log(1.0 - rng_double(m->rng)) * m->inv_log_q);
+        if (skip >= (double)(m->n - 1 - m->pos)) { m->pos = m->n; return -1; }
+        m->pos += (int64_t)skip + 1;
+        return m->pos;
+    }
+    while (++m->pos < m->n)
+        if (rng_next(m->rng) < m->threshold) return m->pos;
+    return -1;
+}
+
+/* safe_window — клетка (r, c) и её соседи в пределах поля: индексы в excl по
+   возрастанию (строки обходятся сверху вниз); r < 0 или c < 0 — окна нет.
+   Окно обрезается по краям поля один раз, до обхода. Возвращает число клеток окна. */
+static int safe_window(const Field* f, int r, int c, int excl[9]) {
+    int ne = 0;
+    if (r < 0 || c < 0) return 0;
+    int r0 = r > 0 ? r - 1 : 0, r1 = r + 1 < f->rows ? r + 1 : f->rows - 1;
+    int c0 = c > 0 ? c - 1 : 0, c1 = c + 1 < f->cols ? c + 1 : f->cols - 1;
+    for (int rr = r0; rr <= r1; ++rr)
+        for (int cc = c0; cc <= c1; ++cc) excl[ne++] = IDX(f, rr, cc);
+    return ne;
+}
+
+   /* generate_by_probability_ex
+      - Каждая клетка становится миной независимо с вероятностью percent% (допускаются
+        дробные значения, например 15.5). Мины выбирает MineSampler.
+      - excl_r, excl_c >= 0: клетка (excl_r, excl_c) и её соседи остаются без мин
+        (безопасное первое открытие), остальные клетки — с той же вероятностью;
+        -1 — без исключений.
       - После расстановки мин вызывает compute_counts.
       - percent ограничен 0..100.
    */
-void generate_by_probability(Field* f, int percent) {
+void generate_by_probability_ex(Field* f, double percent, Rng* rng, int excl_r, int excl_c) {
     if (!f) return;
-    if (percent < 0) percent = 0;
-    if (percent > 100) percent = 100;
+    STAT_ADD(attempts, 1);
+    STAT_TIME_BEGIN(t0);
 
     field_clear(f);
-    int R = f->rows, C = f->cols;
+    int excl[9], ne = safe_window(f, excl_r, excl_c, excl), k = 0;
     int placed = 0;
-
-    for (int r = 0; r < R; ++r)
-        for (int c = 0; c < C; ++c) {
-            int i = IDX(f, r, c);
-            if ((rand() % 100) < percent) { // вероятность percent%
-                f->is_mine[i] = 1;
-                ++placed;
-            }
-        }
+    MineSampler m;
+    mine_sampler_init(&m, rng, percent, (int64_t)f->rows * f->cols);
+    for (int64_t i; (i = mine_sampler_next(&m)) >= 0;) {
+        while (k < ne && excl[k] < i) ++k; /* номера клеток растут */
+        if (k < ne && excl[k] == i) continue;
+        field_set_mine(f, (int)i, 1);
+        ++placed;
+    }
     f->mines = placed;
     compute_counts(f);
+    STAT_TIME_END(t_generate, t0);
+}
+
+/* generate_by_probability — generate_by_probability_ex без исключённых клеток. */
+void generate_by_probability(Field* f, double percent, Rng* rng) {
+    generate_by_probability_ex(f, percent, rng, -1, -1);
+}
+
+/* exact_skip — номер t среди разрешённых клеток -> индекс клетки поля
+   (excl — запрещённые клетки по возрастанию). */
+static inline int exact_skip(int t, const int* excl, int ne) {
+    for (int k = 0; k < ne; ++k)
+        if (t >= excl[k]) ++t;
+    return t;
+}
+
+   /* generate_exact
+      - Ставит ровно mines мин (не больше, чем есть разрешённых клеток) выборкой
+        Флойда: для j = n - mines .. n - 1 берётся случайное t из [0, j]; если t уже
+        занято, берётся j. Это O(mines) случайных чисел при любом размере поля,
+        а занятость проверяется по самому полю мин — дополнительная память не нужна.
+      - excl_r, excl_c >= 0: клетка (excl_r, excl_c) и её соседи остаются без мин
+        (безопасное первое открытие); -1 — без исключений.
+      - После расстановки вызывает compute_counts.
+   */
+void generate_exact(Field* f, int mines, Rng* rng, int excl_r, int excl_c) {
+    if (!f) return;
+    STAT_ADD(attempts, 1);
+    STAT_TIME_BEGIN(t0);
+
+    field_clear(f);
+    int N = f->rows * f->cols;
+    int excl[9], ne = safe_window(f, excl_r, excl_c, excl);
+
+    int avail = N - ne;
+    if (mines > avail) mines = avail;
+    if (mines < 0) mines = 0;
+    for (int j = avail - mines; j < avail; ++j) {
+        int p = exact_skip((int)rng_below(rng, (uint64_t)j + 1), excl, ne);
+        if (field_mine(f, p)) p = exact_skip(j, excl, ne);
+        field_set_mine(f, p, 1);
+    }
+    f->mines = mines;
+    compute_counts(f);
+    STAT_TIME_END(t_generate, t0);
+}
+
+/* generate_board — mines >= 0: ровно mines мин (generate_exact), иначе — с вероятностью percent%;
+   excl_r, excl_c >= 0 — окно 3x3 вокруг этой клетки без мин. */
+static void generate_board(Field* f, double percent, int mines, Rng* rng, int excl_r, int excl_c) {
+    if (mines >= 0) generate_exact(f, mines, rng, excl_r, excl_c);
+    else generate_by_probability_ex(f, percent, rng, excl_r, excl_c);
 }
 
 /* ===================================================================
    Печать поля (ASCII)
    =================================================================== */
 
+   /*
+     Поле выводится кадрами: все строки окна форматируются в один буфер
+     (RenderBuf) и пишутся одним fwrite. Буфер принадлежит вызывающему —
+     статических буферов нет, так что печать можно вызывать из разных потоков.
+     Окно (viewport) задаёт участок поля, компактный режим убирает сетку —
+     один символ на клетку, как в файле, но с '*' и '.' вместо 'M' и '0'.
+   */
+
+   /* RenderOpts — что и как выводить. */
+typedef struct {
+    int row0, col0; /* левый верхний угол окна */
+    int rows, cols; /* размер окна; <= 0 — до края поля */
+    bool compact;   /* без линий сетки */
+} RenderOpts;
+
+/* RenderBuf — буфер кадра; растёт по мере надобности. */
+typedef struct {
+    char* data;
+    size_t cap;
+} RenderBuf;
+
+static void render_buf_free(RenderBuf* b) {
+    free(b->data);
+    b->data = NULL;
+    b->cap = 0;
+}
+
+/* render_cell_char — '*' для мины, '.' для нуля, иначе цифра. */
+static inline char render_cell_char(const Field* f, int i) {
+    if (field_mine(f, i)) return '*';
+    int n = field_count(f, i);
+    return n == 0 ? '.' : (char)('0' + n);
+}
+
+/* render_field
+   - Выводит окно o поля f в out одним fwrite. Если окно меньше поля,
+     перед ним печатается строка с его границами (нумерация с 0).
+   - Возвращает false при ошибке памяти или записи.
+*/
+bool render_field(const Field* f, const RenderOpts* o, RenderBuf* b, FILE* out) {
+    if (!f || !o || !b || !out) return false;
+    int R = f->rows, C = f->cols;
+    int r0 = o->row0 < 0 ? 0 : (o->row0 >= R ? R - 1 : o->row0);
+    int c0 = o->col0 < 0 ? 0 : (o->col0 >= C ? C - 1 : o->col0);
+    int h = (o->rows <= 0 || o->rows > R - r0) ? R - r0 : o->rows;
+    int w = (o->cols <= 0 || o->cols > C - c0) ? C - c0 : o->cols;
+
+    size_t line = o->compact ? (size_t)w + 1 : 4 * (size_t)w + 2;
+    size_t lines = o->compact ? (size_t)h : 2 * (size_t)h + 1;
+    size_t need = line * lines + 128;
+    if (need > b->cap) {
+        char* d = (char*)realloc(b->data, need);
+        if (!d) return false;
+        b->data = d;
+        b->cap = need;
+    }
+
+    char* p = b->data;
+    if (h < R || w < C)
+        p += snprintf(p, 128, "строки %d..%d из %d, столбцы %d..%d из %d\n",
+            r0, r0 + h - 1, R, c0, c0 + w - 1, C);
+
+    char* border = NULL; /* первая линия сетки — образец для остальных */
+    if (!o->compact) {
+        border = p;
+        *p++ = '+';
+        for (int c = 0; c < w; ++c) { memcpy(p, "---+", 4); p += 4; }
+        *p++ = '\n';
+    }
+    for (int r = r0; r < r0 + h; ++r) {
+        int i = IDX(f, r, c0);
+        if (o->compact) {
+            for (int c = 0; c < w; ++c) *p++ = render_cell_char(f, i + c);
+            *p++ = '\n';
+            continue;
+        }
+        *p++ = '|';
+        for (int c = 0; c < w; ++c) {
+            p[0] = ' ';
+            p[1] = render_cell_char(f, i + c);
+            p[2] = ' ';
+            p[3] = '|';
+            p += 4;
+        }
+        *p++ = '\n';
+        memcpy(p, border, line);
+        p += line;
+    }
+
+    size_t len = (size_t)(p - b->data);
+    return fwrite(b->data, 1, len, out) == len;
+}
+
    /* print_field_ascii
-      - Печатает поле в виде таблицы.
-      - show_mines=true: мины отображаются '*'.
-      - Значение 0 отображается как '.', 1..8 — цифры.
+      - Печатает поле целиком в виде таблицы (render_field с сеткой).
+      - Мины отображаются '*' (в этой программе для простоты всегда, show_mines
+        оставлен для совместимости), 0 — '.', 1..8 — цифры.
    */
 void print_field_ascii(const Field* f, bool show_mines) {
+    RenderBuf buf = { NULL, 0 };
+    (void)show_mines;
     if (!f) return;
+    RenderOpts o = { 0, 0, 0, 0, false };
+    render_field(f, &o, &buf, stdout);
+    render_buf_free(&buf);
+}
 
-    int R = f->rows, C = f->cols;
+#define VIEW_GRID_MAX 40    /* поля не больше 40x40 печатаются целиком с сеткой */
+#define VIEW_WINDOW_ROWS 40 /* окно по умолчанию для больших полей */
+#define VIEW_WINDOW_COLS 100
 
-    printf("+");
-    for (int c = 0; c < C; ++c) printf("---+");
-    printf("\n");
+   /* show_field
+      - Печать поля в диалоге: маленькое — целиком (print_field_ascii), большое —
+        компактным окном; участок можно выбрать, пока не будет введена пустая строка.
+      - Буфер кадра свой на вызов и переиспользуется между кадрами диалога.
+   */
+void show_field(const Field* f) {
+    RenderBuf buf = { NULL, 0 };
+    if (!f) return;
+    if (f->rows <= VIEW_GRID_MAX && f->cols <= VIEW_GRID_MAX) { print_field_ascii(f, true); return; }
 
-    for (int r = 0; r < R; ++r) {
-        printf("|");
-        for (int c = 0; c < C; ++c) {
-            int i = IDX(f, r, c);
-            char ch;
-            if (show_mines && f->is_mine[i]) ch = '*';
-            else if (f->is_mine[i]) ch = '*'; // в этой программе для простоты всегда показываем мины
-            else ch = (f->count[i] == 0) ? '.' : (char)('0' + f->count[i]);
-            printf(" %c |", ch);
-        }
-        printf("\n+");
-        for (int c = 0; c < C; ++c) printf("---+");
-        printf("\n");
+    RenderOpts o = { 0, 0, VIEW_WINDOW_ROWS, VIEW_WINDOW_COLS, true };
+    for (;;) {
+        render_field(f, &o, &buf, stdout);
+        printf("Поле %dx%d велико для вывода целиком. Другой участок: строка столбец "
+            "[высота ширина [g — с сеткой]]; пустая строка — продолжить: ", f->rows, f->cols);
+        char line[128], mode = 0;
+        int r, c, h = o.rows, w = o.cols;
+        if (!fgets(line, sizeof(line), stdin)) break;
+        int got = sscanf(line, "%d %d %d %d %c", &r, &c, &h, &w, &mode);
+        if (got < 2) break;
+        o.row0 = r;
+        o.col0 = c;
+        o.rows = h;
+        o.cols = w;
+        o.compact = (got < 5 || (mode != 'g' && mode != 'G'));
     }
+    render_buf_free(&buf);
 }
 
 /* ===================================================================
    Сохранение и валидация
    =================================================================== */
 
-   /* save_field_to_file
-      - Сохраняет поле в текстовом формате:
+   /* save_field_to_stream
+      - Записывает поле в открытый поток в текстовом формате:
         первая строка: rows cols mines
         затем rows строк, по cols символов: 'M' или '0'..'8'
+      - Возвращает false при ошибке записи.
    */
-bool save_field_to_file(const Field* f, const char* fname) {
-    if (!f || !fname) return false;
-    FILE* out = fopen(fname, "w");
-    if (!out) return false;
+bool save_field_to_stream(const Field* f, FILE* out) {
+    if (!f || !out) return false;
 
     fprintf(out, "%d %d %d\n", f->rows, f->cols, f->mines);
     for (int r = 0; r < f->rows; ++r) {
         for (int c = 0; c < f->cols; ++c) {
             int i = IDX(f, r, c);
-            fputc(f->is_mine[i] ? 'M' : '0' + f->count[i], out);
+            fputc(field_mine(f, i) ? 'M' : '0' + field_count(f, i), out);
         }
         fputc('\n', out);
     }
-    fclose(out);
-    return true;
+    return !ferror(out);
 }
 
-/* validate_field
-   - Для каждой неминной клетки пересчитывает число соседних мин и сравнивает
-     с f->count[i]. Печатает ошибку для несоответствий и возвращает false,
-     если хоть одно несоответствие найдено.
-*/
-bool validate_field(const Field* f) {
-    if (!f) return false;
-    int R = f->rows, C = f->cols;
-    bool ok = true;
+   /* save_field_to_file
+      - Сохраняет поле в файл fname (формат — см. save_field_to_stream).
+   */
+bool save_field_to_file(const Field* f, const char* fname) {
+    if (!f || !fname) return false;
+    FILE* out = fopen(fname, "w");
+    if (!out) return false;
 
-    for (int r = 0; r < R; ++r) {
+    bool ok = save_field_to_stream(f, out);
+    if (fclose(out) != 0) ok = false;
+    return ok;
+}
+
+   /*
+     Проверка счётчиков идёт полосами строк: каждая полоса пересчитывается тем же
+     ядром, что и compute_counts, и сравнивается с записанными счётчиками. Полосы
+     раздаются потокам по одной (атомарный счётчик), несоответствия копятся по
+     полосам и сливаются в порядке строк, поэтому отчёт не зависит от числа потоков.
+     При stop_first полоса, нашедшая ошибку, записывает свой номер в stop_band;
+     полосы с большими номерами прекращают работу, а меньшие доделываются — так
+     в отчёт попадает именно первое (по порядку строк) несоответствие.
+   */
+#define VALIDATE_PRINT_MAX 20 /* validate_field_ex печатает не больше стольких несоответствий */
+
+/* ValidateMismatch — одно несоответствие счётчика. */
+typedef struct {
+    int row, col;
+    int stored;   /* записано в поле */
+    int expected; /* пересчитано по минам */
+} ValidateMismatch;
+
+/* ValidateOptions — параметры проверки. */
+typedef struct {
+    int threads;     /* потоков (1 — только вызывающий) */
+    bool stop_first; /* остановиться на первом несоответствии */
+    int max_report;  /* сколько несоответствий сохранить в отчёте */
+} ValidateOptions;
+
+/* ValidateReport — итог проверки одного поля. */
+typedef struct {
+    bool done;               /* проверка выполнена (хватило памяти) */
+    long long mismatches;    /* всего несоответствий (при stop_first — 0 или 1) */
+    int reported;            /* сохранено в items */
+    ValidateMismatch* items; /* первые несоответствия в порядке строк */
+} ValidateReport;
+
+static void validate_report_free(ValidateReport* rep) {
+    free(rep->items);
+    memset(rep, 0, sizeof(*rep));
+}
+
+/* ValidateJob — общее задание потоков проверки одного поля. */
+typedef struct {
+    const Field* f;
+    const ValidateOptions* o;
+    int band_rows, nbands;
+    volatile long next_band;
+    volatile long stop_band;  /* наименьшая полоса с ошибкой (nbands — нет), только при stop_first */
+    volatile long failed;     /* у потока не хватило памяти */
+    long long* counts;        /* несоответствий в полосе */
+    int* reported;            /* сохранено несоответствий полосы */
+    ValidateMismatch* items;  /* nbands * max_report */
+} ValidateJob;
+
+/* validate_band — проверяет полосу k; возвращает false, если её надо прервать (stop_first). */
+static bool validate_band(ValidateJob* job, CountRows* b, int k) {
+    const Field* f = job->f;
+    int C = f->cols, cap = job->o->max_report;
+    int r1 = (k + 1) * job->band_rows < f->rows ? (k + 1) * job->band_rows : f->rows;
+    for (int r = k * job->band_rows; r < r1; ++r) {
+        if (job->o->stop_first && atomic_load(&job->stop_band) < k) return false;
+        count_field_row(f, b, r, b->row);
+        /* у мин счётчик 0, как и в результате ядра, так что целая строка сравнивается сразу */
+        if (!f->packed && memcmp(b->row, f->count + (size_t)r * C, C) == 0) continue;
         for (int c = 0; c < C; ++c) {
             int i = IDX(f, r, c);
-            if (f->is_mine[i]) continue;
+            if (field_mine(f, i) || b->row[c] == field_count(f, i)) continue;
+            job->counts[k]++;
+            if (job->reported[k] < cap) {
+                ValidateMismatch* m = &job->items[(size_t)k * cap + job->reported[k]++];
+                m->row = r;
+                m->col = c;
+                m->stored = field_count(f, i);
+                m->expected = b->row[c];
+            }
+            if (job->o->stop_first) { atomic_min(&job->stop_band, k); return false; }
+        }
+    }
+    return true;
+}
 
-            int cnt = 0;
-            for (int dr = -1; dr <= 1; ++dr)
-                for (int dc = -1; dc <= 1; ++dc) {
-                    if (dr == 0 && dc == 0) continue;
-                    int rr = r + dr, cc = c + dc;
-                    if (rr >= 0 && rr < R && cc >= 0 && cc < C)
-                        if (f->is_mine[IDX(f, rr, cc)]) ++cnt;
-                }
+static THREAD_PROC(validate_worker) {
+    ValidateJob* job = (ValidateJob*)arg;
+    CountRows b;
+    if (!count_rows_init(&b, job->f)) { atomic_fetch_inc(&job->failed); THREAD_RETURN; }
+    for (;;) {
+        long k = atomic_fetch_inc(&job->next_band);
+        if (k >= job->nbands) break;
+        if (job->o->stop_first && atomic_load(&job->stop_band) < k) continue;
+        validate_band(job, &b, (int)k);
+    }
+    count_rows_free(&b);
+    stats_flush();
+    THREAD_RETURN;
+}
 
-            if (cnt != f->count[i]) {
-                printf("Ошибка: клетка (%d,%d) имеет count=%d, а должно быть %d\n",
-                    r, c, f->count[i], cnt);
-                ok = false;
-            }
+/* validate_field_bands
+   - Проверяет счётчики поля f полосами строк на o->threads потоках (см. выше).
+   - Заполняет *rep (освобождать validate_report_free); возвращает true, если
+     несоответствий нет. rep->done = false — не хватило памяти.
+*/
+bool validate_field_bands(const Field* f, const ValidateOptions* o, ValidateReport* rep) {
+    memset(rep, 0, sizeof(*rep));
+    if (!f || !o) return false;
+    STAT_TIME_BEGIN(t0);
+    int threads = o->threads < 1 ? 1 : o->threads;
+    int cap = o->max_report < 0 ? 0 : o->max_report;
+
+    ValidateJob job;
+    memset(&job, 0, sizeof(job));
+    job.f = f;
+    job.o = o;
+    /* по 4 полосы на поток: неравномерные по цене строки разойдутся между потоками */
+    job.nbands = threads == 1 ? 1 : threads * 4;
+    if (job.nbands > f->rows) job.nbands = f->rows;
+    job.band_rows = (f->rows + job.nbands - 1) / job.nbands;
+    job.nbands = (f->rows + job.band_rows - 1) / job.band_rows;
+    job.stop_band = job.nbands;
+    job.counts = (long long*)calloc(job.nbands, sizeof(long long));
+    job.reported = (int*)calloc(job.nbands, sizeof(int));
+    job.items = (ValidateMismatch*)malloc(((size_t)job.nbands * cap + 1) * sizeof(ValidateMismatch));
+    rep->items = (ValidateMismatch*)malloc(((size_t)cap + 1) * sizeof(ValidateMismatch));
+    thread_handle* handles = (thread_handle*)malloc(threads * sizeof(thread_handle));
+    bool ok = job.counts && job.reported && job.items && rep->items && handles;
+
+    if (ok) {
+        int started = 0;
+        for (int t = 1; t < threads; ++t)
+            if (thread_start(&handles[t], validate_worker, &job)) ++started;
+        validate_worker(&job);
+        for (int t = 1; t <= started; ++t) thread_join(handles[t]);
+        ok = job.failed == 0 || job.next_band >= job.nbands; /* все полосы кто-то проверил */
+
+        /* слияние по порядку полос */
+        for (int k = 0; k < job.nbands; ++k) {
+            rep->mismatches += job.counts[k];
+            for (int j = 0; j < job.reported[k] && rep->reported < cap; ++j)
+                rep->items[rep->reported++] = job.items[(size_t)k * cap + j];
         }
     }
+    rep->done = ok;
+    free(job.counts);
+    free(job.reported);
+    free(job.items);
+    free(handles);
+    STAT_TIME_END(t_validate, t0);
+    return ok && rep->mismatches == 0;
+}
 
-    if (ok) printf("Валидация пройдена: все счетчики корректны.\n");
+/* validate_field_ex
+   - Для каждой неминной клетки пересчитывает число соседних мин и сравнивает
+     со счётчиком поля (validate_field_bands в одном потоке).
+     Возвращает false, если хоть одно несоответствие найдено.
+   - verbose=true: печатает первые VALIDATE_PRINT_MAX несоответствий и итог проверки.
+*/
+bool validate_field_ex(const Field* f, bool verbose) {
+    if (!f) return false;
+    ValidateOptions o = { 1, !verbose, verbose ? VALIDATE_PRINT_MAX : 0 };
+    ValidateReport rep;
+    bool ok = validate_field_bands(f, &o, &rep);
+    if (verbose) {
+        for (int j = 0; j < rep.reported; ++j)
+            printf("Ошибка: клетка (%d,%d) имеет count=%d, а должно быть %d\n",
+                rep.items[j].row, rep.items[j].col, rep.items[j].stored, rep.items[j].expected);
+        if (rep.mismatches > rep.reported)
+            printf("... и ещё %lld несоответствий\n", rep.mismatches - rep.reported);
+        if (!rep.done) printf("Недостаточно памяти для проверки.\n");
+        if (ok) printf("Валидация пройдена: все счетчики корректны.\n");
+    }
+    validate_report_free(&rep);
     return ok;
 }
 
+/* validate_field — проверка с печатью результата (для интерактивного режима). */
+bool validate_field(const Field* f) {
+    return validate_field_ex(f, true);
+}
+
+/* ===================================================================
+   Загрузка поля и двоичный формат
+   =================================================================== */
+
+   /* load_field_from_file
+      - Читает поле в текстовом формате save_field_to_file.
+      - Очень большие поля загружаются в компактном представлении.
+      - Возвращает NULL, если файл не открылся или формат нарушен
+        (неверный заголовок, не тот символ, короткая или длинная строка).
+   */
+Field* load_field_from_file(const char* fname) {
+    if (!fname) return NULL;
+    FILE* in = fopen(fname, "r");
+    if (!in) return NULL;
+
+    int rows, cols, mines;
+    Field* f = NULL;
+    if (fscanf(in, "%d %d %d", &rows, &cols, &mines) == 3 && rows > 0 && cols > 0 &&
+        (long long)rows * cols <= INT32_MAX)
+        f = field_create_ex(rows, cols, (long long)rows * cols >= PACKED_MIN_CELLS);
+
+    /* строки читаются целиком: cols символов, "\r\n" и завершающий ноль */
+    char* line = f ? (char*)malloc((size_t)cols + 3) : NULL;
+    bool ok = (line != NULL);
+    int placed = 0;
+    for (int r = 0; ok && r < rows; ++r) {
+        do {
+            ok = fgets(line, cols + 3, in) != NULL;
+        } while (ok && (line[0] == '\n' || line[0] == '\r')); /* пустые строки и конец заголовка */
+        for (int c = 0; ok && c < cols; ++c) {
+            char ch = line[c];
+            int i = IDX(f, r, c);
+            if (ch == 'M') { field_set_mine(f, i, 1); ++placed; }
+            else if (ch >= '0' && ch <= '8') field_set_count(f, i, ch - '0');
+            else ok = false; /* не тот символ или короткая строка */
+        }
+        if (ok && line[cols] != '\n' && line[cols] != '\r' && line[cols] != '\0') ok = false; /* длинная */
+    }
+    free(line);
+    fclose(in);
+
+    if (!ok) { field_free(f); return NULL; }
+    f->mines = placed;
+    return f;
+}
+
+   /*
+     Двоичный формат (.msb), все числа — little-endian:
+       смещение  размер  поле
+       0         4       сигнатура "MSWB"
+       4         2       версия формата (BOARD_BIN_VERSION)
+       6         2       флаги: бит 0 — есть плоскость счётчиков
+       8         4       rows
+       12        4       cols
+       16        4       mines
+       20        4       зарезервировано (0)
+       24        8       seed, из которого получено поле (0 — неизвестен)
+       32        ...     плоскость мин: 1 бит на клетку, клетка i — бит (i % 8) байта i / 8
+       далее     ...     (необязательно) плоскость счётчиков: 4 бита на клетку,
+                         клетка i — младшая (чётные i) или старшая (нечётные) тетрада байта i / 2
+     Плоскости совпадают с компактным представлением Field, поэтому отображённый
+     в память файл сразу используется как поле без копирования (field_view_open).
+   */
+#define BOARD_BIN_MAGIC "MSWB"
+#define BOARD_BIN_VERSION 1
+#define BOARD_BIN_HEADER 32
+#define BOARD_BIN_HAS_COUNTS 0x0001
+
+static void put_le(unsigned char* p, uint64_t v, int bytes) {
+    for (int k = 0; k < bytes; ++k) p[k] = (unsigned char)(v >> (8 * k));
+}
+
+static uint64_t get_le(const unsigned char* p, int bytes) {
+    uint64_t v = 0;
+    for (int k = 0; k < bytes; ++k) v |= (uint64_t)p[k] << (8 * k);
+    return v;
+}
+
+/* save_field_binary
+   - Сохраняет поле в двоичном формате; with_counts — записывать ли плоскость счётчиков.
+   - Поле в обычном представлении упаковывается на лету.
+*/
+bool save_field_binary(const Field* f, const char* fname, uint64_t seed, bool with_counts) {
+    if (!f || !fname) return false;
+    FILE* out = fopen(fname, "wb");
+    if (!out) return false;
+
+    unsigned char hdr[BOARD_BIN_HEADER] = { 0 };
+    memcpy(hdr, BOARD_BIN_MAGIC, 4);
+    put_le(hdr + 4, BOARD_BIN_VERSION, 2);
+    put_le(hdr + 6, with_counts ? BOARD_BIN_HAS_COUNTS : 0, 2);
+    put_le(hdr + 8, (uint64_t)f->rows, 4);
+    put_le(hdr + 12, (uint64_t)f->cols, 4);
+    put_le(hdr + 16, (uint64_t)f->mines, 4);
+    put_le(hdr + 24, seed, 8);
+    bool ok = fwrite(hdr, 1, sizeof(hdr), out) == sizeof(hdr);
+
+    size_t n = (size_t)f->rows * f->cols;
+    if (f->packed) {
+        ok = ok && fwrite(f->is_mine, 1, bitset_bytes(n), out) == bitset_bytes(n);
+        if (with_counts) ok = ok && fwrite(f->count, 1, (n + 1) / 2, out) == (n + 1) / 2;
+    }
+    else {
+        /* упаковываем блоками по 8 клеток (мины) и по 2 клетки (счётчики) */
+        unsigned char buf[4096];
+        size_t k = 0;
+        for (size_t i = 0; ok && i < n; i += 8) {
+            unsigned char b = 0;
+            for (size_t j = i; j < i + 8 && j < n; ++j) b |= (unsigned char)(f->is_mine[j] << (j - i));
+            buf[k++] = b;
+            if (k == sizeof(buf)) { ok = fwrite(buf, 1, k, out) == k; k = 0; }
+        }
+        for (size_t i = 0; ok && with_counts && i < n; i += 2) {
+            buf[k++] = (unsigned char)(f->count[i] | (i + 1 < n ? f->count[i + 1] << 4 : 0));
+            if (k == sizeof(buf)) { ok = fwrite(buf, 1, k, out) == k; k = 0; }
+        }
+        if (ok && k > 0) ok = fwrite(buf, 1, k, out) == k;
+    }
+
+    if (fclose(out) != 0) ok = false;
+    return ok;
+}
+
+   /* FieldView — поле только для чтения поверх отображённого в память файла.
+      view.field можно передавать в функции, принимающие const Field*;
+      изменять его и вызывать для него field_free нельзя.
+   */
+typedef struct {
+    Field field;
+    uint64_t seed;
+    const unsigned char* base; /* начало отображения */
+    size_t size;               /* размер отображения */
+    unsigned char* own_count;  /* счётчики, посчитанные при открытии (если их нет в файле) */
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+} FieldView;
+
+/* map_file_readonly — отображает файл в память только для чтения. */
+static bool map_file_readonly(FieldView* v, const char* fname) {
+#ifdef _WIN32
+    v->file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (v->file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(v->file, &size) || size.QuadPart == 0) { CloseHandle(v->file); return false; }
+    v->mapping = CreateFileMappingA(v->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!v->mapping) { CloseHandle(v->file); return false; }
+    v->base = (const unsigned char*)MapViewOfFile(v->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!v->base) { CloseHandle(v->mapping); CloseHandle(v->file); return false; }
+    v->size = (size_t)size.QuadPart;
+    return true;
+#else
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* отображение остаётся действительным и после закрытия файла */
+    if (p == MAP_FAILED) return false;
+    v->base = (const unsigned char*)p;
+    v->size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+static void unmap_file(FieldView* v) {
+#ifdef _WIN32
+    UnmapViewOfFile(v->base);
+    CloseHandle(v->mapping);
+    CloseHandle(v->file);
+#else
+    munmap((void*)v->base, v->size);
+#endif
+}
+
+/* field_view_open
+   - Отображает двоичный файл поля в память и заполняет view без копирования плоскостей.
+   - Если в файле нет плоскости счётчиков, она вычисляется при открытии.
+   - Возвращает false, если файл не открылся или это не поле в двоичном формате.
+*/
+bool field_view_open(FieldView* v, const char* fname) {
+    if (!v || !fname) return false;
+    memset(v, 0, sizeof(*v));
+    if (!map_file_readonly(v, fname)) return false;
+
+    const unsigned char* h = v->base;
+    bool ok = v->size >= BOARD_BIN_HEADER && memcmp(h, BOARD_BIN_MAGIC, 4) == 0 &&
+        get_le(h + 4, 2) == BOARD_BIN_VERSION;
+    uint64_t rows = ok ? get_le(h + 8, 4) : 0, cols = ok ? get_le(h + 12, 4) : 0;
+    ok = ok && rows > 0 && cols > 0 && rows * cols <= INT32_MAX;
+
+    size_t n = (size_t)(rows * cols);
+    bool has_counts = ok && (get_le(h + 6, 2) & BOARD_BIN_HAS_COUNTS);
+    size_t need = BOARD_BIN_HEADER + bitset_bytes(n) + (has_counts ? (n + 1) / 2 : 0);
+    ok = ok && v->size >= need;
+    if (!ok) { unmap_file(v); return false; }
+
+    Field* f = &v->field;
+    f->rows = (int)rows;
+    f->cols = (int)cols;
+    f->mines = (int)get_le(h + 16, 4);
+    f->packed = true;
+    f->is_mine = (unsigned char*)(h + BOARD_BIN_HEADER);
+    v->seed = get_le(h + 24, 8);
+    if (has_counts) {
+        f->count = (unsigned char*)(h + BOARD_BIN_HEADER + bitset_bytes(n));
+    }
+    else {
+        v->own_count = (unsigned char*)calloc((n + 1) / 2, sizeof(unsigned char));
+        if (!v->own_count) { unmap_file(v); return false; }
+        f->count = v->own_count;
+        compute_counts(f); /* пишет только в count */
+    }
+    return true;
+}
+
+/* field_view_close — снимает отображение и освобождает посчитанные счётчики. */
+void field_view_close(FieldView* v) {
+    if (!v || !v->base) return;
+    unmap_file(v);
+    free(v->own_count);
+    memset(v, 0, sizeof(*v));
+}
+
+/* is_binary_board_file — начинается ли файл с сигнатуры двоичного формата. */
+static bool is_binary_board_file(const char* fname) {
+    FILE* in = fopen(fname, "rb");
+    if (!in) return false;
+    char magic[4];
+    bool yes = fread(magic, 1, 4, in) == 4 && memcmp(magic, BOARD_BIN_MAGIC, 4) == 0;
+    fclose(in);
+    return yes;
+}
+
+/* parse_long_arg / parse_double_arg — разбор числового аргумента целиком. */
+static bool parse_long_arg(const char* s, long long* v) {
+    char* end;
+    *v = strtoll(s, &end, 10);
+    return end != s && *end == '\0';
+}
+static bool parse_double_arg(const char* s, double* v) {
+    char* end;
+    *v = strtod(s, &end);
+    return end != s && *end == '\0';
+}
+
+/* parse_density_arg
+   - "15", "15.5" — вероятность мины в процентах (*mines = -1);
+   - "99m"        — ровно 99 мин (*percent = 0).
+   - Проверяет диапазоны: 0..100% или 0..cells мин.
+*/
+static bool parse_density_arg(const char* s, long long cells, double* percent, int* mines) {
+    size_t len = strlen(s);
+    *percent = 0;
+    *mines = -1;
+    if (len > 1 && (s[len - 1] == 'm' || s[len - 1] == 'M')) {
+        char buf[32];
+        long long k;
+        if (len >= sizeof(buf)) return false;
+        memcpy(buf, s, len - 1);
+        buf[len - 1] = '\0';
+        if (!parse_long_arg(buf, &k) || k < 0 || k > cells) return false;
+        *mines = (int)k;
+        return true;
+    }
+    return parse_double_arg(s, percent) && *percent >= 0 && *percent <= 100;
+}
+
+/* run_convert
+   - minesweeper --convert IN OUT
+   - Двоичный файл переводится в текстовый, текстовый — в двоичный (со счётчиками).
+*/
+int run_convert(int argc, char** argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Использование: %s --convert IN OUT\n"
+            "  двоичный IN (.msb) сохраняется как текст, текстовый — как двоичный.\n", argv[0]);
+        return 2;
+    }
+    const char* in = argv[2];
+    const char* out = argv[3];
+    bool ok;
+
+    if (is_binary_board_file(in)) {
+        FieldView v;
+        if (!field_view_open(&v, in)) { fprintf(stderr, "Не удалось прочитать %s\n", in); return 1; }
+        ok = save_field_to_file(&v.field, out);
+        field_view_close(&v);
+    }
+    else {
+        Field* f = load_field_from_file(in);
+        if (!f) { fprintf(stderr, "Не удалось прочитать %s\n", in); return 1; }
+        ok = save_field_binary(f, out, 0, true);
+        field_free(f);
+    }
+    if (!ok) fprintf(stderr, "Ошибка при сохранении в %s\n", out);
+    return ok ? 0 : 1;
+}
+
+/* run_view
+   - minesweeper --view FILE [ROW COL HEIGHT WIDTH] [grid]
+   - Печатает окно поля из файла (по умолчанию — целиком) компактно или с сеткой.
+     Двоичный файл отображается в память, так что смотреть участок большого поля
+     можно, не читая его целиком.
+*/
+int run_view(int argc, char** argv) {
+    bool grid = argc > 3 && strcmp(argv[argc - 1], "grid") == 0;
+    int nargs = argc - 2 - (grid ? 1 : 0);
+    long long v[4] = { 0, 0, 0, 0 };
+    bool ok = nargs == 1 || nargs == 5;
+    for (int k = 0; ok && nargs == 5 && k < 4; ++k)
+        ok = parse_long_arg(argv[3 + k], &v[k]) && v[k] >= 0 && v[k] <= INT32_MAX;
+    if (!ok) {
+        fprintf(stderr, "Использование: %s --view FILE [ROW COL HEIGHT WIDTH] [grid]\n"
+            "  HEIGHT, WIDTH = 0 — до края поля; grid — с линиями сетки.\n", argv[0]);
+        return 2;
+    }
+    const char* in = argv[2];
+    RenderOpts o = { (int)v[0], (int)v[1], (int)v[2], (int)v[3], !grid };
+    RenderBuf buf = { NULL, 0 };
+
+    if (is_binary_board_file(in)) {
+        FieldView fv;
+        if (!field_view_open(&fv, in)) { fprintf(stderr, "Не удалось прочитать %s\n", in); return 1; }
+        ok = render_field(&fv.field, &o, &buf, stdout);
+        field_view_close(&fv);
+    }
+    else {
+        Field* f = load_field_from_file(in);
+        if (!f) { fprintf(stderr, "Не удалось прочитать %s\n", in); return 1; }
+        ok = render_field(f, &o, &buf, stdout);
+        field_free(f);
+    }
+    render_buf_free(&buf);
+    return ok ? 0 : 1;
+}
+
+/* ===================================================================
+   Проверка сохранённых полей (--validate)
+   =================================================================== */
+
+   /*
+     minesweeper --validate [-j N] [--stop-first] [--max-report K] PATH...
+       - PATH — файл поля (текстовый или .msb) или каталог: проверяются все файлы
+         в нём (без подкаталогов) по алфавиту;
+       - несколько файлов проверяются одновременно на N потоках (по умолчанию — все
+         ядра), каждый в одном потоке; единственный файл проверяется полосами строк
+         на N потоках (validate_field_bands);
+       - на каждый файл, в порядке списка и по мере готовности, печатается
+           ИМЯ: ok
+           ИМЯ: несоответствий N
+             строка R, столбец C: записано X, должно быть Y   (не больше K строк, по умолчанию 10)
+           ИМЯ: ошибка чтения
+         --stop-first прекращает проверку файла на первом несоответствии;
+       - итог печатается в stderr; код завершения 0 — все файлы корректны,
+         1 — есть ошибки, 2 — неверные аргументы.
+   */
+#define VALIDATE_DEFAULT_REPORT 10
+
+/* ValidateFile — один файл в списке проверки. */
+typedef struct {
+    char* path;
+    bool readable;     /* файл прочитан и проверен */
+    bool no_counts;    /* двоичный файл без плоскости счётчиков — проверять нечего */
+    bool finished;
+    ValidateReport rep;
+} ValidateFile;
+
+/* ValidateRun — общее задание потоков проверки файлов. */
+typedef struct {
+    ValidateFile* files;
+    int nfiles;
+    ValidateOptions opts;     /* параметры проверки одного файла */
+    volatile long next_file;
+    mutex_handle lock;        /* защищает next_print и печать */
+    int next_print;           /* следующий файл для печати по порядку */
+    long long ok, bad, unreadable;
+} ValidateRun;
+
+static char* dup_string(const char* s) {
+    size_t n = strlen(s) + 1;
+    char* d = (char*)malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+static int path_cmp(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* list_push — добавляет копию строки в растущий массив. */
+static bool list_push(char*** list, int* n, int* cap, const char* s) {
+    if (*n == *cap) {
+        int ncap = *cap ? *cap * 2 : 64;
+        char** nl = (char**)realloc(*list, ncap * sizeof(char*));
+        if (!nl) return false;
+        *list = nl;
+        *cap = ncap;
+    }
+    char* d = dup_string(s);
+    if (!d) return false;
+    (*list)[(*n)++] = d;
+    return true;
+}
+
+/* collect_board_files
+   - Добавляет в список path (файл) или все обычные файлы каталога path (по алфавиту).
+   - Возвращает false, если путь не открылся или не хватило памяти.
+*/
+static bool collect_board_files(const char* path, char*** list, int* n, int* cap) {
+    int first = *n;
+    char full[1024];
+#ifdef _WIN32
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES) return false;
+    if (!(attr & FILE_ATTRIBUTE_DIRECTORY)) return list_push(list, n, cap, path);
+    snprintf(full, sizeof(full), "%s\\*", path);
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(full, &fd);
+    if (h == INVALID_HANDLE_VALUE) return true; /* пустой каталог */
+    bool ok = true;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        snprintf(full, sizeof(full), "%s\\%s", path, fd.cFileName);
+        ok = list_push(list, n, cap, full);
+    } while (ok && FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    if (!S_ISDIR(st.st_mode)) return list_push(list, n, cap, path);
+    DIR* d = opendir(path);
+    if (!d) return false;
+    bool ok = true;
+    struct dirent* e;
+    while (ok && (e = readdir(d)) != NULL) {
+        snprintf(full, sizeof(full), "%s/%s", path, e->d_name);
+        if (stat(full, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        ok = list_push(list, n, cap, full);
+    }
+    closedir(d);
+#endif
+    qsort(*list + first, *n - first, sizeof(char*), path_cmp);
+    return ok;
+}
+
+/* validate_board_file — читает файл (текст или .msb) и проверяет его счётчики. */
+static void validate_board_file(ValidateFile* vf, const ValidateOptions* o) {
+    if (is_binary_board_file(vf->path)) {
+        FieldView v;
+        if (!field_view_open(&v, vf->path)) return;
+        vf->readable = true;
+        vf->no_counts = v.own_count != NULL; /* счётчики посчитаны при открытии */
+        if (!vf->no_counts) validate_field_bands(&v.field, o, &vf->rep);
+        else vf->rep.done = true;
+        field_view_close(&v);
+        return;
+    }
+    Field* f = load_field_from_file(vf->path);
+    if (!f) return;
+    vf->readable = true;
+    validate_field_bands(f, o, &vf->rep);
+    field_free(f);
+}
+
+/* validate_print_file — строка результата по файлу (и первые несоответствия). */
+static void validate_print_file(ValidateRun* run, ValidateFile* vf) {
+    if (!vf->readable || !vf->rep.done) {
+        printf("%s: ошибка чтения\n", vf->path);
+        run->unreadable++;
+    }
+    else if (vf->rep.mismatches == 0) {
+        printf("%s: ok%s\n", vf->path, vf->no_counts ? " (нет счётчиков)" : "");
+        run->ok++;
+    }
+    else {
+        printf("%s: несоответствий %lld\n", vf->path, vf->rep.mismatches);
+        for (int j = 0; j < vf->rep.reported; ++j) {
+            const ValidateMismatch* m = &vf->rep.items[j];
+            printf("  строка %d, столбец %d: записано %d, должно быть %d\n",
+                m->row, m->col, m->stored, m->expected);
+        }
+        run->bad++;
+    }
+    validate_report_free(&vf->rep);
+}
+
+static THREAD_PROC(validate_files_worker) {
+    ValidateRun* run = (ValidateRun*)arg;
+    for (;;) {
+        long k = atomic_fetch_inc(&run->next_file);
+        if (k >= run->nfiles) break;
+        validate_board_file(&run->files[k], &run->opts);
+
+        /* печать по порядку: выводим всё готовое начиная с next_print */
+        mutex_lock(&run->lock);
+        run->files[k].finished = true;
+        while (run->next_print < run->nfiles && run->files[run->next_print].finished)
+            validate_print_file(run, &run->files[run->next_print++]);
+        mutex_unlock(&run->lock);
+    }
+    stats_flush();
+    THREAD_RETURN;
+}
+
+/* run_validate — разбор аргументов и проверка списка файлов; возвращает код завершения. */
+int run_validate(int argc, char** argv) {
+    int threads = cpu_count();
+    ValidateOptions o = { 1, false, VALIDATE_DEFAULT_REPORT };
+    char** paths = NULL;
+    int npaths = 0, cap = 0;
+    bool ok = true;
+    int a = 2;
+    for (; ok && a < argc && argv[a][0] == '-'; ++a) {
+        long long v;
+        if (strcmp(argv[a], "--stop-first") == 0) o.stop_first = true;
+        else if (strcmp(argv[a], "--max-report") == 0 && a + 1 < argc && parse_long_arg(argv[a + 1], &v) &&
+            v >= 0 && v <= 1000000) { o.max_report = (int)v; ++a; }
+        else if (strcmp(argv[a], "-j") == 0 && a + 1 < argc && parse_long_arg(argv[a + 1], &v) &&
+            v >= 1 && v <= 1024) { threads = (int)v; ++a; }
+        else ok = false;
+    }
+    if (!ok || a >= argc) {
+        fprintf(stderr, "Использование: %s --validate [-j N] [--stop-first] [--max-report K] PATH...\n"
+            "  PATH — файл поля (текст или .msb) или каталог с файлами полей.\n", argv[0]);
+        return 2;
+    }
+    for (; a < argc; ++a)
+        if (!collect_board_files(argv[a], &paths, &npaths, &cap)) {
+            fprintf(stderr, "Не удалось прочитать %s\n", argv[a]);
+            ok = false;
+        }
+
+    ValidateRun run;
+    memset(&run, 0, sizeof(run));
+    run.files = (ValidateFile*)calloc(npaths > 0 ? npaths : 1, sizeof(ValidateFile));
+    run.nfiles = npaths;
+    run.opts = o;
+    double t0 = now_seconds();
+    if (run.files) {
+        for (int k = 0; k < npaths; ++k) run.files[k].path = paths[k];
+        /* один файл — потоки делят его строки, несколько — сами файлы */
+        int workers = npaths < threads ? npaths : threads;
+        if (npaths == 1) { run.opts.threads = threads; workers = 1; }
+        mutex_init(&run.lock);
+        thread_handle* handles = (thread_handle*)malloc((workers > 0 ? workers : 1) * sizeof(thread_handle));
+        int started = 0;
+        for (int t = 1; handles && t < workers; ++t)
+            if (thread_start(&handles[t], validate_files_worker, &run)) ++started;
+        validate_files_worker(&run);
+        for (int t = 1; t <= started; ++t) thread_join(handles[t]);
+        free(handles);
+        mutex_destroy(&run.lock);
+    }
+    else ok = false;
+    fflush(stdout);
+
+    fprintf(stderr, "Проверено файлов: %d (корректны: %lld, с ошибками: %lld, не прочитаны: %lld) за %.3f с\n",
+        npaths, run.ok, run.bad, run.unreadable, now_seconds() - t0);
+#ifdef MS_STATS
+    {
+        SolverStats st = stats_take();
+        stats_print(stderr, &st);
+    }
+#endif
+    for (int k = 0; k < npaths; ++k) free(paths[k]);
+    free(paths);
+    free(run.files);
+    return (ok && run.bad == 0 && run.unreadable == 0) ? 0 : 1;
+}
+
+/* ===================================================================
+   Детерминистический солвер (локальные правила)
+   =================================================================== */
+
+   /*
+     Идея (простыми словами):
+       - Мы моделируем, как играет человек, применяя только очевидные локальные правила,
+         без угадывания и сложных дедукций.
+       - Правила те же, что в реальной игре:
+           * Если число в клетке n == (количество помеченных мин) + (количество закрытых соседних клеток),
+             то все эти закрытые клетки — мины.
+           * Если число в клетке n == (количество помеченных мин), то все остальные закрытые
+             соседние клетки безопасны и их можно открыть.
+       - С ключом --pair-rules, когда эти два правила ничего не дают, применяется
+         правило C — сравнение двух соседних чисел (см. ниже). По умолчанию оно
+         выключено, и решаемость поля означает решаемость правилами A и B.
+       - Алгоритм стартует с одной стартовой клетки (как будто игрок кликнул на неё).
+         Мы будем пробовать разные стартовые клетки (в check_solvability).
+   */
+
+   /* -------------------------------------------------------------------
+      Состояние солвера и очередь "грязных" клеток (worklist).
+
+      Вместо полных проходов по всем R*C клеткам с пересчётом 8 соседей
+      у каждой солвер работает инкрементально:
+        - для каждой клетки поддерживаются счётчики соседей (в одном байте):
+            младшие 4 бита : закрытые и непомеченные соседи (unknown)
+            старшие 4 бита : соседи, помеченные как мины (inferred)
+        - когда клетка открывается или помечается миной, счётчики её соседей
+          обновляются, а открытые соседи ставятся в очередь на повторную проверку;
+        - правила применяются только к клеткам из очереди.
+      Все выводы правил A и B верны (поле согласовано, старт безопасен), поэтому
+      итоговая неподвижная точка не зависит от порядка обработки клеток и совпадает
+      с результатом полных проходов до стабилизации.
+
+      Флаги "открыта", "мина" и "в очереди" хранятся битовыми множествами, так что
+      на клетку приходится два байта состояния (счётчики и копия числа) плюс
+      очередь, размер которой определяется фронтом изменений, а не размером поля.
+
+      Всё состояние солвера лежит на сетке с рамкой в одну клетку:
+      (rows + 2) x (cols + 2), клетка (r, c) имеет индекс (r + 1) * w + c + 1,
+      где w = cols + 2. Клетки рамки помечены как мины (inferred_mine) и имеют
+      число NUM_BORDER, поэтому правила их пропускают, а обход восьми соседей —
+      это восемь постоянных смещений off[] без проверок границ. Числа клеток
+      копируются из поля при solver_ctx_bind (num), так что горячие циклы не
+      обращаются к Field и его компактному представлению. Снаружи (стартовая
+      клетка, zones, координаты результата) используются обычные индексы поля.
+      ------------------------------------------------------------------- */
+#define NBR_UNKNOWN(x)  ((x) & 0x0F)
+#define NBR_INFERRED(x) ((x) >> 4)
+#define NUM_MINE   9     /* num: клетка — мина */
+#define NUM_BORDER 0xFF  /* num: клетка рамки */
+
+/* IntVec — растущий массив int (очереди и списки клеток). */
+typedef struct {
+    int* a;
+    int n;
+    int cap;
+} IntVec;
+
+/* intvec_push — добавляет x; при нехватке памяти возвращает false. */
+static bool intvec_push(IntVec* v, int x) {
+    if (v->n == v->cap) {
+        int cap = v->cap ? v->cap * 2 : 64;
+        int* a = (int*)realloc(v->a, cap * sizeof(int));
+        if (!a) return false;
+        v->a = a;
+        v->cap = cap;
+    }
+    v->a[v->n++] = x;
+    return true;
+}
+
+static void intvec_free(IntVec* v) {
+    free(v->a);
+    v->a = NULL;
+    v->n = v->cap = 0;
+}
+
+/* solver_pair_rules_default — включено ли правило C в новых контекстах
+   (ключ --pair-rules включает его для всех режимов). */
+static bool solver_pair_rules_default = false;
+
+   /* SolverCtx — контекст солвера, создаётся один раз на размер поля.
+      Хранит рабочие массивы и кэш числа безопасных клеток привязанного поля,
+      поэтому check_solvability и циклы генерации не выделяют память на каждый
+      запуск солвера. Между запусками состояние сбрасывается по журналу changed:
+      откатываются только клетки, изменённые прошлым запуском. Если их было больше
+      n / 8, журнал не ведётся и сброс делается полной очисткой — её цена сравнима
+      с работой самого запуска. Так сброс никогда не стоит больше, чем прошлый запуск.
+   */
+typedef struct {
+    int rows, cols, n;            /* размеры поля, для которого создан контекст */
+    int w, pn;                    /* ширина строки с рамкой (cols + 2) и число клеток с рамкой */
+    int off[8];                   /* смещения восьми соседей в индексах с рамкой */
+    int safe_total;               /* кэш: число безопасных клеток привязанного поля */
+    int opened;                   /* сколько безопасных клеток уже открыто */
+    long long processed;          /* сколько клеток взято из очереди (мера работы солвера) */
+    bool oom;                     /* не хватило памяти под очередь — результат недостоверен */
+    bool full_reset;              /* журнал changed неполон — нужен полный сброс */
+    unsigned char* open;          /* битовое множество: клетка открыта */
+    unsigned char* inferred_mine; /* битовое множество: клетка точно мина (внутренняя пометка) */
+    unsigned char* queued;        /* битовое множество: клетка уже стоит в очереди */
+    unsigned char* pair_queued;   /* битовое множество: клетка стоит в очереди правила C */
+    unsigned char* nbr;           /* счётчики соседей: unknown | inferred << 4 */
+    unsigned char* num;           /* число клетки 0..8, NUM_MINE или NUM_BORDER (копия поля) */
+    unsigned char* failed;        /* битовое множество check_solvability: заведомо неудачные старты */
+    IntVec work;                  /* очередь клеток на проверку (используется как стек) */
+    IntVec pair_work;             /* очередь правила C: клетки, у которых что-то изменилось */
+    bool pair_rules;              /* применять правило C, когда A и B застряли */
+    IntVec changed;               /* клетки, открытые или помеченные текущим запуском */
+    int changed_limit;            /* предел длины журнала changed */
+    struct StartClass* zones;     /* буфер классов стартовых клеток (см. check_solvability) */
+    int zones_cap;                /* ёмкость буфера zones */
+} SolverCtx;
+
+/* solver_ctx_clear_all — полный сброс: все клетки закрыты, unknown = число соседей. */
+static void solver_ctx_clear_all(SolverCtx* s) {
+    int R = s->rows, C = s->cols, W = s->w;
+    size_t bits = bitset_bytes(s->pn);
+    memset(s->open, 0, bits);
+    memset(s->inferred_mine, 0, bits);
+    memset(s->queued, 0, bits);
+    memset(s->pair_queued, 0, bits);
+    /* рамка — "помеченные мины": правила её пропускают */
+    for (int c = 0; c < W; ++c) {
+        bit_set(s->inferred_mine, c);
+        bit_set(s->inferred_mine, (size_t)(R + 1) * W + c);
+    }
+    for (int r = 1; r <= R; ++r) {
+        bit_set(s->inferred_mine, (size_t)r * W);
+        bit_set(s->inferred_mine, (size_t)r * W + C + 1);
+    }
+    /* у угловых клеток 3 соседа, у крайних — 5, у внутренних — 8 */
+    for (int r = 0; r < R; ++r) {
+        int nr = (r > 0) + 1 + (r < R - 1);
+        unsigned char* row = s->nbr + (size_t)(r + 1) * W + 1;
+        for (int c = 0; c < C; ++c) {
+            int nc = (c > 0) + 1 + (c < C - 1);
+            row[c] = (unsigned char)(nr * nc - 1);
+        }
+    }
+}
+
+/* solver_pad — индекс поля -> индекс с рамкой. */
+static inline int solver_pad(const SolverCtx* s, int p) {
+    return p + 2 * (p / s->cols) + s->w + 1;
+}
+
+/* solver_unpad — индекс с рамкой -> индекс поля. */
+static inline int solver_unpad(const SolverCtx* s, int q) {
+    return (q / s->w - 1) * s->cols + q % s->w - 1;
+}
+
+/* solver_ctx_create
+   - Выделяет контекст и его массивы для полей rows x cols.
+   - Возвращает NULL при ошибке выделения памяти.
+*/
+/* solver_ctx_init_dims — размеры, смещения соседей и настройки контекста (без буферов). */
+static void solver_ctx_init_dims(SolverCtx* s, int rows, int cols) {
+    s->rows = rows;
+    s->cols = cols;
+    s->n = rows * cols;
+    s->w = cols + 2;
+    s->pn = (rows + 2) * s->w;
+    int W = s->w;
+    const int off[8] = { -W - 1, -W, -W + 1, -1, 1, W - 1, W, W + 1 };
+    memcpy(s->off, off, sizeof(off));
+    s->changed_limit = s->n / 8 > 64 ? s->n / 8 : 64;
+    s->pair_rules = solver_pair_rules_default;
+}
+
+SolverCtx* solver_ctx_create(int rows, int cols) {
+    if (rows <= 0 || cols <= 0 || (long long)(rows + 2) * (cols + 2) > INT32_MAX) return NULL;
+    SolverCtx* s = (SolverCtx*)calloc(1, sizeof(SolverCtx));
+    if (!s) return NULL;
+    solver_ctx_init_dims(s, rows, cols);
+    size_t bits = bitset_bytes(s->pn);
+    s->open = (unsigned char*)malloc(bits);
+    s->inferred_mine = (unsigned char*)malloc(bits);
+    s->queued = (unsigned char*)malloc(bits);
+    s->pair_queued = (unsigned char*)malloc(bits);
+    s->failed = (unsigned char*)malloc(bits);
+    s->nbr = (unsigned char*)malloc(s->pn * sizeof(unsigned char));
+    s->num = (unsigned char*)malloc(s->pn * sizeof(unsigned char));
+    if (!s->open || !s->inferred_mine || !s->queued || !s->pair_queued || !s->failed || !s->nbr || !s->num) {
+        free(s->open); free(s->inferred_mine); free(s->queued); free(s->pair_queued);
+        free(s->failed); free(s->nbr); free(s->num);
+        free(s);
+        return NULL;
+    }
+    memset(s->num, NUM_BORDER, s->pn); /* внутренние клетки заполнит solver_ctx_bind */
+    solver_ctx_clear_all(s);
+    return s;
+}
+
+/* solver_ctx_free — освобождает контекст; безопасно вызывать с NULL. */
+void solver_ctx_free(SolverCtx* s) {
+    if (!s) return;
+    free(s->open);
+    free(s->inferred_mine);
+    free(s->queued);
+    free(s->pair_queued);
+    free(s->failed);
+    free(s->nbr);
+    free(s->num);
+    free(s->zones);
+    intvec_free(&s->work);
+    intvec_free(&s->pair_work);
+    intvec_free(&s->changed);
+    free(s);
+}
+
+/* SOLVER_NEIGHBOURS
+   - Выполняет блок STMT для восьми соседей клетки p сетки с рамкой ширины W
+     (сосед — в переменной q) в том же порядке, что s->off[].
+   - Без цикла: в специализациях FIELD_PRESETS W — константа, и все восемь
+     смещений становятся непосредственными операндами.
+   - STMT — блок в фигурных скобках без continue/break (они вышли бы из do/while).
+*/
+#define SOLVER_NEIGHBOURS(p, W, q, STMT) do {              \
+        int q;                                             \
+        q = (p) - (W) - 1; STMT q = (p) - (W); STMT        \
+        q = (p) - (W) + 1; STMT q = (p) - 1; STMT          \
+        q = (p) + 1; STMT q = (p) + (W) - 1; STMT          \
+        q = (p) + (W); STMT q = (p) + (W) + 1; STMT        \
+    } while (0)
+
+   /* Горячие функции солвера ниже написаны с шириной сетки W параметром (суффикс _w)
+      и подставляются целиком: общие версии передают s->w, специализации
+      solver_ctx_run для FIELD_PRESETS — константу. */
+
+/* solver_ctx_reset — возвращает контекст к состоянию "всё закрыто" (см. SolverCtx). */
+static MS_FORCE_INLINE void solver_ctx_reset_w(SolverCtx* s, int W) {
+    if (s->full_reset || s->oom) {
+        solver_ctx_clear_all(s);
+    }
+    else {
+        for (int k = 0; k < s->changed.n; ++k) {
+            int p = s->changed.a[k];
+            /* открытие уменьшало unknown соседей на 1; пометка миной — ещё и inferred + 1 */
+            int delta = bit_get(s->open, p) ? 1 : -(0x10 - 1);
+            bit_clear(s->open, p);
+            bit_clear(s->inferred_mine, p);
+            SOLVER_NEIGHBOURS(p, W, q, { s->nbr[q] = (unsigned char)(s->nbr[q] + delta); });
+        }
+        /* очереди пусты после solver_propagate, но могли остаться от прерванной работы */
+        for (int k = 0; k < s->work.n; ++k) bit_clear(s->queued, s->work.a[k]);
+        for (int k = 0; k < s->pair_work.n; ++k) bit_clear(s->pair_queued, s->pair_work.a[k]);
+    }
+    s->changed.n = 0;
+    s->work.n = 0;
+    s->pair_work.n = 0;
+    s->opened = 0;
+    s->processed = 0;
+    s->oom = false;
+    s->full_reset = false;
+}
+static void solver_ctx_reset(SolverCtx* s) { solver_ctx_reset_w(s, s->w); }
+
+/* solver_log_change — записывает клетку в журнал changed (или отказывается от журнала). */
+static inline void solver_log_change(SolverCtx* s, int p) {
+    if (s->full_reset) return;
+    if (s->changed.n >= s->changed_limit || !intvec_push(&s->changed, p)) s->full_reset = true;
+}
+
+/* solver_push — ставит открытую клетку в очередь, если её там ещё нет. */
+static inline void solver_push(SolverCtx* s, int p) {
+    if (bit_get(s->queued, p)) return;
+    if (!intvec_push(&s->work, p)) { s->oom = true; return; }
+    bit_set(s->queued, p);
+    STAT_ADD(queue_pushes, 1);
+}
+
+/* solver_open_cell
+   - Открывает безопасную клетку p: уменьшает unknown у соседей,
+     ставит в очередь саму клетку и её открытые соседей.
+*/
+static MS_FORCE_INLINE void solver_open_cell_w(SolverCtx* s, int p, int W) {
+    bit_set(s->open, p);
+    s->opened++;
+    solver_log_change(s, p);
+    SOLVER_NEIGHBOURS(p, W, p2, {
+        s->nbr[p2] -= 1; /* у клеток рамки счётчик ни на что не влияет */
+        if (bit_get(s->open, p2)) solver_push(s, p2);
+    });
+    solver_push(s, p);
+}
+static void solver_open_cell(SolverCtx* s, int p) { solver_open_cell_w(s, p, s->w); }
+
+/* solver_mark_mine
+   - Помечает клетку p как мину: у соседей unknown уменьшается,
+     inferred увеличивается, открытые соседи ставятся в очередь.
+*/
+static MS_FORCE_INLINE void solver_mark_mine_w(SolverCtx* s, int p, int W) {
+    bit_set(s->inferred_mine, p);
+    solver_log_change(s, p);
+    SOLVER_NEIGHBOURS(p, W, p2, {
+        s->nbr[p2] += 0x10 - 1; /* inferred + 1, unknown - 1 */
+        if (bit_get(s->open, p2)) solver_push(s, p2);
+    });
+}
+static void solver_mark_mine(SolverCtx* s, int p) { solver_mark_mine_w(s, p, s->w); }
+
+/* solver_pair_push — ставит открытую клетку в очередь правила C. */
+static inline void solver_pair_push(SolverCtx* s, int p) {
+    if (bit_get(s->pair_queued, p)) return;
+    if (!intvec_push(&s->pair_work, p)) { s->oom = true; return; }
+    bit_set(s->pair_queued, p);
+}
+
+   /* -------------------------------------------------------------------
+      Правило C (пары чисел) — включается, когда A и B больше ничего не дают.
+
+      Для открытой клетки a: U_a — её закрытые непомеченные соседи, m_a — сколько
+      среди них мин (число минус inferred). Для соседней по окну 5x5 открытой
+      клетки b — то же. Общая часть U_a и U_b содержит k мин, где
+          lo = max(0, m_a - |U_a \ U_b|, m_b - |U_b \ U_a|) <= k <= hi = min(|U_a ∩ U_b|, m_a, m_b),
+      значит в U_a \ U_b от m_a - hi до m_a - lo мин:
+        * m_a - hi == |U_a \ U_b| -> все клетки U_a \ U_b — мины;
+        * m_a - lo == 0           -> все клетки U_a \ U_b безопасны;
+      и симметрично для b. Сюда входят вложенные множества (U_a ⊆ U_b) и
+      шаблоны 1-2-1, 1-2-2-1 у края открытой области. Все выводы верны без
+      угадывания, поэтому монотонность (а с ней кэш failed) сохраняется.
+
+      Пары проверяются не полным проходом по фронту, а своей очередью: клетка
+      попадает в неё, когда её обработали правила A/B и она осталась с unknown > 0.
+      Любое изменение в U_a или U_b ставит a или b в обычную очередь, а оттуда —
+      в очередь пар, так что ни одна пара, где мог появиться вывод, не пропускается.
+      ------------------------------------------------------------------- */
+
+/* solver_pair_apply — открывает (или помечает минами) соседей a, не соседних с b. */
+static void solver_pair_apply(SolverCtx* s, int a, int b, bool mines) {
+    int W = s->w;
+    int ra = a / W, ca = a % W, rb = b / W, cb = b % W;
+    for (int dr = -1; dr <= 1; ++dr)
+        for (int dc = -1; dc <= 1; ++dc) {
+            if (dr == 0 && dc == 0) continue;
+            if (abs(ra + dr - rb) <= 1 && abs(ca + dc - cb) <= 1) continue; /* общая часть */
+            int p2 = a + dr * W + dc;
+            if (bit_get(s->open, p2) || bit_get(s->inferred_mine, p2)) continue; /* и рамка */
+            if (mines) solver_mark_mine(s, p2);
+            else solver_open_cell(s, p2);
+        }
+}
+
+/* solver_pair_check
+   - Применяет правило C к клетке a и всем её открытым партнёрам b в окне 5x5.
+   - Возвращает true, если что-то выведено (новые клетки уже стоят в очереди A/B).
+*/
+static bool solver_pair_check(SolverCtx* s, int a) {
+    int R = s->rows, C = s->cols, W = s->w;
+    int ra = a / W, ca = a % W; /* координаты с рамкой: клетки поля — 1..R, 1..C */
+    int ua = NBR_UNKNOWN(s->nbr[a]);
+    if (ua == 0) return false;
+    int ma = s->num[a] - NBR_INFERRED(s->nbr[a]);
+
+    /* окно 5x5 шире рамки, поэтому границы партнёров проверяются явно */
+    for (int rb = ra - 2; rb <= ra + 2; ++rb)
+        for (int cb = ca - 2; cb <= ca + 2; ++cb) {
+            if ((rb == ra && cb == ca) || rb < 1 || rb > R || cb < 1 || cb > C) continue;
+            int b = rb * W + cb;
+            if (!bit_get(s->open, b)) continue;
+            int ub = NBR_UNKNOWN(s->nbr[b]);
+            if (ub == 0) continue;
+            int mb = s->num[b] - NBR_INFERRED(s->nbr[b]);
+
+            /* |U_a ∩ U_b|: закрытые непомеченные клетки в пересечении окон 3x3
+               (пересечение не выходит за рамку, а рамка помечена минами) */
+            int nab = 0;
+            int r0 = (ra > rb ? ra : rb) - 1, r1 = (ra < rb ? ra : rb) + 1;
+            int c0 = (ca > cb ? ca : cb) - 1, c1 = (ca < cb ? ca : cb) + 1;
+            for (int rr = r0; rr <= r1; ++rr)
+                for (int cc = c0; cc <= c1; ++cc) {
+                    int p2 = rr * W + cc;
+                    if (!bit_get(s->open, p2) && !bit_get(s->inferred_mine, p2)) ++nab;
+                }
+            if (nab == 0) continue;
+
+            int a_only = ua - nab, b_only = ub - nab;
+            int lo = 0, hi = nab;
+            if (ma - a_only > lo) lo = ma - a_only;
+            if (mb - b_only > lo) lo = mb - b_only;
+            if (ma < hi) hi = ma;
+            if (mb < hi) hi = mb;
+
+            bool a_mines = a_only > 0 && ma - hi == a_only;
+            bool a_safe = a_only > 0 && ma - lo == 0;
+            bool b_mines = b_only > 0 && mb - hi == b_only;
+            bool b_safe = b_only > 0 && mb - lo == 0;
+            if (!a_mines && !a_safe && !b_mines && !b_safe) continue;
+
+            STAT_ADD(rule_pair, 1);
+            if (a_mines || a_safe) solver_pair_apply(s, a, b, a_mines);
+            if (b_mines || b_safe) solver_pair_apply(s, b, a, b_mines);
+            return true;
+        }
+    return false;
+}
+
+/* solver_propagate
+   - Обрабатывает очередь, пока она не опустеет, применяя к каждой клетке правила:
+       * Правило A: число == inferred + unknown -> все unknown — мины.
+       * Правило B: число == inferred -> все unknown безопасны -> открываем их.
+   - Нулевые клетки раскрываются тем же правилом B (у нуля inferred == 0),
+     поэтому отдельный BFS для нулевых областей не нужен.
+   - Когда очередь пуста и включено правило C, разбирается очередь пар; первый
+     же вывод возвращает работу правилам A и B (они дешевле).
+*/
+static MS_FORCE_INLINE void solver_propagate_w(SolverCtx* s, int W) {
+    for (;;) {
+        STAT_ADD(rounds, 1);
+        while (s->work.n > 0) {
+            int p = s->work.a[--s->work.n];
+            bit_clear(s->queued, p);
+            s->processed++;
+            STAT_ADD(cells_examined, 1);
+
+            int unknown = NBR_UNKNOWN(s->nbr[p]);
+            if (unknown == 0) continue; /* вокруг всё уже известно */
+
+            int n = s->num[p];
+            int inferred = NBR_INFERRED(s->nbr[p]);
+            bool all_mines = (n == inferred + unknown); /* Правило A */
+            bool all_safe = (n == inferred);            /* Правило B */
+            if (!all_mines && !all_safe) {
+                if (s->pair_rules) solver_pair_push(s, p);
+                continue;
+            }
+            if (all_mines) STAT_ADD(rule_a, 1);
+            else STAT_ADD(rule_b, 1);
+
+            /* сначала закрытые соседи (рамка помечена миной и отсеивается),
+               затем один цикл: open/mark подставляются один раз, а не восемь */
+            int todo[8], nt = 0;
+            SOLVER_NEIGHBOURS(p, W, p2, {
+                todo[nt] = p2;
+                nt += !bit_get(s->open, p2) && !bit_get(s->inferred_mine, p2);
+            });
+            for (int k = 0; k < nt; ++k) {
+                if (all_mines) solver_mark_mine_w(s, todo[k], W);
+                else solver_open_cell_w(s, todo[k], W);
+            }
+        }
+
+        /* A и B застряли — правило C */
+        bool progress = false;
+        while (!progress && s->pair_work.n > 0) {
+            int p = s->pair_work.a[--s->pair_work.n];
+            bit_clear(s->pair_queued, p);
+            progress = solver_pair_check(s, p);
+            if (progress) solver_pair_push(s, p); /* у p могут быть и другие пары */
+        }
+        if (!progress) break;
+    }
+}
+static void solver_propagate(SolverCtx* s) { solver_propagate_w(s, s->w); }
+
+/* solver_ctx_bind
+   - Привязывает контекст к полю f (размеры должны совпадать): копирует числа
+     клеток в num, кэширует число безопасных клеток и сбрасывает состояние.
+     Вызывается после каждого изменения поля (новая генерация, загрузка).
+   - Возвращает false, если размеры поля не совпадают с размерами контекста.
+*/
+bool solver_ctx_bind(SolverCtx* s, const Field* f) {
+    if (!s || !f || f->rows != s->rows || f->cols != s->cols) return false;
+    int R = s->rows, C = s->cols, safe = 0;
+    for (int r = 0; r < R; ++r) {
+        unsigned char* row = s->num + (size_t)(r + 1) * s->w + 1;
+        int base = r * C;
+        for (int c = 0; c < C; ++c) {
+            if (field_mine(f, base + c)) row[c] = NUM_MINE;
+            else { row[c] = (unsigned char)field_count(f, base + c); ++safe; }
+        }
+    }
+    s->safe_total = safe;
+    solver_ctx_reset(s);
+    return true;
+}
+
+/* solver_ctx_run
+   - Сбрасывает состояние прошлого запуска и запускает солвер из клетки start_idx
+     поля f, к которому контекст привязан solver_ctx_bind.
+   - Возвращает true, если открыты все безопасные клетки. Состояние после запуска
+     (open — в индексах с рамкой, opened, processed) остаётся в контексте до
+     следующего сброса.
+   - Для размеров FIELD_PRESETS работает специализация с шириной-константой.
+*/
+static MS_FORCE_INLINE bool solver_ctx_run_w(SolverCtx* s, const Field* f, int start_idx, int W) {
+    solver_ctx_reset_w(s, W);
+    if (field_mine(f, start_idx)) return false;
+    STAT_ADD(solver_runs, 1);
+
+    /* открываем стартовую клетку и распространяем следствия */
+    solver_open_cell_w(s, solver_pad(s, start_idx), W);
+    solver_propagate_w(s, W);
+    return !s->oom && s->opened == s->safe_total;
+}
+
+/* DEFINE_SOLVER_PRESET
+   - solver_ctx_run для поля PR x PC: ширина сетки с рамкой — константа PC + 2,
+     так что в подставленных solver_open_cell_w, solver_mark_mine_w и
+     solver_propagate_w восемь соседей адресуются непосредственными смещениями,
+     без загрузок из s->off[].
+*/
+#define DEFINE_SOLVER_PRESET(PR, PC)                                               \
+static bool solver_ctx_run_##PR##x##PC(SolverCtx* s, const Field* f, int start_idx) { \
+    return solver_ctx_run_w(s, f, start_idx, PC + 2);                              \
+}
+FIELD_PRESETS(DEFINE_SOLVER_PRESET)
+#undef DEFINE_SOLVER_PRESET
+
+bool solver_ctx_run(SolverCtx* s, const Field* f, int start_idx) {
+#define SOLVER_PRESET_CASE(PR, PC) \
+    if (s->rows == PR && s->cols == PC) return solver_ctx_run_##PR##x##PC(s, f, start_idx);
+    FIELD_PRESETS(SOLVER_PRESET_CASE)
+#undef SOLVER_PRESET_CASE
+    return solver_ctx_run_w(s, f, start_idx, s->w);
+}
+
+/* ===================================================================
+   Параллельный солвер одного большого поля (полосы строк)
+   =================================================================== */
+
+   /*
+     Поле делится на горизонтальные полосы, по одной на поток. Полоса владеет
+     своими строками: только её поток меняет состояние, счётчики соседей и
+     очереди этих клеток. Работа идёт синхронными шагами:
+       - в начале шага поток разбирает сообщения соседних полос, затем свою
+         очередь правилами A и B (нулевые области раскрываются тем же правилом B);
+       - вывод о клетке соседней полосы (ореол — одна строка над и под полосой)
+         не применяется, а уходит владельцу сообщением SET; изменение своей
+         клетки в крайней строке полосы уходит соседу сообщением NOTE, чтобы
+         тот обновил счётчики своих клеток вокруг неё;
+       - в конце шага потоки встречаются на барьере; если за шаг никто ничего
+         не отправил, достигнута общая неподвижная точка правил A и B.
+     Состояние чужих клеток во время шага не читается. Счётчики своей клетки
+     могут отставать (NOTE ещё не пришёл), но отставание значит лишь, что
+     известно меньше фактов, и выводы A/B по ним остаются верными. Повторный
+     SET для уже известной клетки владелец пропускает.
+
+     Правило C смотрит в окно 5x5, то есть на две строки чужой полосы, поэтому
+     оно выполняется отдельным шагом в неподвижной точке: в этот шаг общее
+     состояние никто не пишет, каждый поток проверяет свою очередь пар и
+     отправляет выводы сообщениями SET (в том числе самому себе).
+
+     Все выводы верны, а набор выводимых фактов монотонен, поэтому неподвижная
+     точка совпадает с последовательным solver_ctx_run — отличаются только
+     порядок и число шагов. Состояние — это массивы SolverCtx на сетке с рамкой
+     (те же битовые множества, счётчики nbr и числа num), так что своей памяти
+     на клетку полосы не добавляют. Границы полос выбираются так, чтобы строки
+     каждой полосы начинались с целого байта битовых множеств: тогда потоки
+     никогда не пишут в один байт.
+   */
+#ifndef PAR_MIN_BAND_ROWS
+#define PAR_MIN_BAND_ROWS 64            /* полосы тоньше не создаются: обмен дороже работы */
+#endif
+#define PAR_SOLVER_MIN_CELLS (1000 * 1000) /* с такого размера --bench сравнивает полосы с одним потоком */
+
+enum { MSG_SET_OPEN, MSG_SET_MINE, MSG_NOTE_OPEN, MSG_NOTE_MINE };
+
+/* BandMsg — сообщение между полосами: клетка (индекс с рамкой) и что с ней произошло. */
+typedef struct {
+    int p;
+    int kind;
+} BandMsg;
+
+typedef struct {
+    BandMsg* a;
+    int n;
+    int cap;
+} BandMsgVec;
+
+/* RoundBarrier — барьер шага; заодно собирает признак "кто-то работал". */
+typedef struct {
+    mutex_handle lock;
+    cond_handle wake;
+    int count, waiting;
+    long generation;
+    bool any, result;
+} RoundBarrier;
+
+typedef struct BandSolver BandSolver;
+
+/* SolverBand — полоса строк [r0, r1) и её рабочие данные. */
+typedef struct {
+    BandSolver* bs;
+    int index;
+    int r0, r1;
+    int lo, hi;               /* свои клетки — индексы с рамкой [lo, hi) */
+    IntVec work;              /* очередь A/B (стек) */
+    IntVec pair_work;         /* очередь правила C */
+    BandMsgVec out[2][3];     /* исходящие по чётности шага: вверх, себе, вниз */
+    int opened;               /* открыто клеток в полосе */
+    bool oom;
+} SolverBand;
+
+/* BandSolver — общее задание потоков: контекст солвера и полосы. */
+struct BandSolver {
+    SolverCtx* s;
+    int start;                /* стартовая клетка, индекс с рамкой */
+    SolverBand* bands;
+    int nbands;               /* число полос = число запущенных потоков */
+    bool go;                  /* полосы размечены, можно начинать */
+    RoundBarrier barrier;
+};
+
+/* round_barrier_wait — ждёт все потоки шага; возвращает true, если хоть один был активен. */
+static bool round_barrier_wait(RoundBarrier* b, bool active) {
+    mutex_lock(&b->lock);
+    b->any = b->any || active;
+    bool result;
+    if (++b->waiting == b->count) {
+        b->result = b->any;
+        b->any = false;
+        b->waiting = 0;
+        b->generation++;
+        cond_broadcast(&b->wake);
+    }
+    else {
+        long gen = b->generation;
+        while (gen == b->generation) cond_wait(&b->wake, &b->lock);
+    }
+    result = b->result;
+    mutex_unlock(&b->lock);
+    return result;
+}
+
+/* band_send — ставит сообщение в исходящие шага cur в направлении dir (-1, 0, +1). */
+static void band_send(SolverBand* b, int cur, int dir, int p, int kind) {
+    BandMsgVec* v = &b->out[cur][dir + 1];
+    if (v->n == v->cap) {
+        int cap = v->cap ? v->cap * 2 : 64;
+        BandMsg* a = (BandMsg*)realloc(v->a, cap * sizeof(BandMsg));
+        if (!a) { b->oom = true; return; }
+        v->a = a;
+        v->cap = cap;
+    }
+    v->a[v->n].p = p;
+    v->a[v->n].kind = kind;
+    v->n++;
+}
+
+/* band_dir — чья клетка p: -1 — полосы выше, 0 — своя, +1 — полосы ниже. */
+static inline int band_dir(const SolverBand* b, int p) {
+    return p < b->lo ? -1 : (p >= b->hi ? 1 : 0);
+}
+
+/* band_unknown — клетка закрыта и не помечена (клетки рамки помечены минами). */
+static inline bool band_unknown(const SolverCtx* s, int p) {
+    return !bit_get(s->open, p) && !bit_get(s->inferred_mine, p);
+}
+
+static inline void band_push(SolverBand* b, int p) {
+    SolverCtx* s = b->bs->s;
+    if (bit_get(s->queued, p)) return;
+    if (!intvec_push(&b->work, p)) { b->oom = true; return; }
+    bit_set(s->queued, p);
+    STAT_ADD(queue_pushes, 1);
+}
+
+static inline void band_pair_push(SolverBand* b, int p) {
+    SolverCtx* s = b->bs->s;
+    if (bit_get(s->pair_queued, p)) return;
+    if (!intvec_push(&b->pair_work, p)) { b->oom = true; return; }
+    bit_set(s->pair_queued, p);
+}
+
+/* band_update_around
+   - Клетка p (своя или из ореола) открыта или помечена миной: обновляет счётчики
+     её соседей в строках полосы и ставит открытых из них в очередь.
+   - Соседи из чужих строк пропускаются; для клеток не у края полосы все восемь
+     смещений off[] свои, и проверка не нужна.
+*/
+static void band_update_around(SolverBand* b, int p, bool mine) {
+    SolverCtx* s = b->bs->s;
+    unsigned char d = (unsigned char)(mine ? 0x10 - 1 : -1);
+    bool edge = p - s->w - 1 < b->lo || p + s->w + 1 >= b->hi;
+    for (int k = 0; k < 8; ++k) {
+        int p2 = p + s->off[k];
+        if (edge && band_dir(b, p2) != 0) continue;
+        s->nbr[p2] = (unsigned char)(s->nbr[p2] + d); /* у клеток рамки ни на что не влияет */
+        if (bit_get(s->open, p2)) band_push(b, p2);
+    }
+}
+
+/* band_set — открывает (или помечает миной) свою клетку p и сообщает соседним полосам. */
+static void band_set(SolverBand* b, int cur, int p, bool mine) {
+    BandSolver* bs = b->bs;
+    SolverCtx* s = bs->s;
+    bit_set(mine ? s->inferred_mine : s->open, p);
+    band_update_around(b, p, mine);
+    int kind = mine ? MSG_NOTE_MINE : MSG_NOTE_OPEN;
+    if (p < b->lo + s->w && b->index > 0) band_send(b, cur, -1, p, kind);
+    if (p >= b->hi - s->w && b->index < bs->nbands - 1) band_send(b, cur, 1, p, kind);
+    if (!mine) {
+        b->opened++;
+        band_push(b, p);
+    }
+}
+
+/* band_deduce
+   - Вывод "p безопасна / мина": своя клетка применяется сразу, чужая — сообщением.
+   - Над первой и под последней полосой только рамка — туда ничего не отправляется.
+*/
+static void band_deduce(SolverBand* b, int cur, int p, bool mine) {
+    int dir = band_dir(b, p);
+    if (dir == 0) {
+        if (band_unknown(b->bs->s, p)) band_set(b, cur, p, mine);
+    }
+    else if (b->index + dir >= 0 && b->index + dir < b->bs->nbands)
+        band_send(b, cur, dir, p, mine ? MSG_SET_MINE : MSG_SET_OPEN);
+}
+
+/* band_receive — разбирает сообщения прошлого шага (prev), адресованные полосе. */
+static void band_receive(SolverBand* b, int cur, int prev) {
+    BandSolver* bs = b->bs;
+    const BandMsgVec* in[3] = {
+        &b->out[prev][1],
+        b->index > 0 ? &bs->bands[b->index - 1].out[prev][2] : NULL,
+        b->index < bs->nbands - 1 ? &bs->bands[b->index + 1].out[prev][0] : NULL
+    };
+    for (int k = 0; k < 3; ++k) {
+        if (!in[k]) continue;
+        for (int j = 0; j < in[k]->n; ++j) {
+            const BandMsg* m = &in[k]->a[j];
+            if (m->kind == MSG_NOTE_OPEN || m->kind == MSG_NOTE_MINE)
+                band_update_around(b, m->p, m->kind == MSG_NOTE_MINE);
+            else if (band_unknown(bs->s, m->p))
+                band_set(b, cur, m->p, m->kind == MSG_SET_MINE);
+        }
+    }
+}
+
+/* band_propagate — правила A и B по очереди полосы, как в solver_propagate. */
+static void band_propagate(SolverBand* b, int cur) {
+    SolverCtx* s = b->bs->s;
+    while (b->work.n > 0) {
+        int p = b->work.a[--b->work.n];
+        bit_clear(s->queued, p);
+        STAT_ADD(cells_examined, 1);
+
+        int unknown = NBR_UNKNOWN(s->nbr[p]);
+        if (unknown == 0) continue;
+        int n = s->num[p];
+        int inferred = NBR_INFERRED(s->nbr[p]);
+        bool all_mines = (n == inferred + unknown); /* Правило A */
+        bool all_safe = (n == inferred);            /* Правило B */
+        if (!all_mines && !all_safe) {
+            if (s->pair_rules) band_pair_push(b, p);
+            continue;
+        }
+        if (all_mines) STAT_ADD(rule_a, 1);
+        else STAT_ADD(rule_b, 1);
+
+        for (int k = 0; k < 8; ++k) band_deduce(b, cur, p + s->off[k], all_mines);
+    }
+}
+
+/* band_pair_emit — выводы правила C для соседей a вне окна b (только сообщениями). */
+static void band_pair_emit(SolverBand* b, int cur, int a, int pb, bool mines) {
+    SolverCtx* s = b->bs->s;
+    int W = s->w, rb = pb / W, cb = pb % W;
+    for (int k = 0; k < 8; ++k) {
+        int p2 = a + s->off[k];
+        if (abs(p2 / W - rb) <= 1 && abs(p2 % W - cb) <= 1) continue; /* общая часть */
+        if (!band_unknown(s, p2)) continue;                          /* и рамка */
+        band_send(b, cur, band_dir(b, p2), p2, mines ? MSG_SET_MINE : MSG_SET_OPEN);
+    }
+}
+
+/* band_pair_step
+   - Шаг правила C: разбирает очередь пар полосы по неизменному в этот шаг полю
+     (оценки те же, что в solver_pair_check) и отправляет все выводы сообщениями.
+*/
+static void band_pair_step(SolverBand* b, int cur) {
+    SolverCtx* s = b->bs->s;
+    int R = s->rows, C = s->cols, W = s->w;
+    while (b->pair_work.n > 0) {
+        int a = b->pair_work.a[--b->pair_work.n];
+        bit_clear(s->pair_queued, a);
+        int ua = NBR_UNKNOWN(s->nbr[a]);
+        if (ua == 0) continue;
+        int ma = s->num[a] - NBR_INFERRED(s->nbr[a]);
+        int ra = a / W, ca = a % W;
+
+        /* окно 5x5 шире рамки, поэтому границы партнёров проверяются явно */
+        for (int rb = ra - 2; rb <= ra + 2; ++rb)
+            for (int cb = ca - 2; cb <= ca + 2; ++cb) {
+                if ((rb == ra && cb == ca) || rb < 1 || rb > R || cb < 1 || cb > C) continue;
+                int pb = rb * W + cb;
+                if (!bit_get(s->open, pb)) continue;
+                int ub = NBR_UNKNOWN(s->nbr[pb]);
+                if (ub == 0) continue;
+                int mb = s->num[pb] - NBR_INFERRED(s->nbr[pb]);
+
+                int nab = 0;
+                int r0 = (ra > rb ? ra : rb) - 1, r1 = (ra < rb ? ra : rb) + 1;
+                int c0 = (ca > cb ? ca : cb) - 1, c1 = (ca < cb ? ca : cb) + 1;
+                for (int rr = r0; rr <= r1; ++rr)
+                    for (int cc = c0; cc <= c1; ++cc)
+                        if (band_unknown(s, rr * W + cc)) ++nab;
+                if (nab == 0) continue;
+
+                int a_only = ua - nab, b_only = ub - nab;
+                int lo = 0, hi = nab;
+                if (ma - a_only > lo) lo = ma - a_only;
+                if (mb - b_only > lo) lo = mb - b_only;
+                if (ma < hi) hi = ma;
+                if (mb < hi) hi = mb;
+
+                bool a_mines = a_only > 0 && ma - hi == a_only;
+                bool a_safe = a_only > 0 && ma - lo == 0;
+                bool b_mines = b_only > 0 && mb - hi == b_only;
+                bool b_safe = b_only > 0 && mb - lo == 0;
+                if (!a_mines && !a_safe && !b_mines && !b_safe) continue;
+
+                STAT_ADD(rule_pair, 1);
+                if (a_mines || a_safe) band_pair_emit(b, cur, a, pb, a_mines);
+                if (b_mines || b_safe) band_pair_emit(b, cur, pb, a, b_mines);
+            }
+    }
+}
+
+static THREAD_PROC(band_worker) {
+    SolverBand* b = (SolverBand*)arg;
+    BandSolver* bs = b->bs;
+    bool pair_step = false;
+
+    /* ждём, пока станет известно, сколько потоков запустилось и какие у полос строки */
+    mutex_lock(&bs->barrier.lock);
+    while (!bs->go) cond_wait(&bs->barrier.wake, &bs->barrier.lock);
+    mutex_unlock(&bs->barrier.lock);
+    if (b->index >= bs->nbands) THREAD_RETURN;
+
+    for (int k = 0;; ++k) {
+        int cur = k & 1;
+        for (int d = 0; d < 3; ++d) b->out[cur][d].n = 0;
+        STAT_ADD(rounds, 1);
+        if (pair_step) band_pair_step(b, cur);
+        else {
+            if (k == 0) {
+                if (band_dir(b, bs->start) == 0) band_set(b, cur, bs->start, false);
+            }
+            else band_receive(b, cur, cur ^ 1);
+            band_propagate(b, cur);
+        }
+        bool active = b->out[cur][0].n + b->out[cur][1].n + b->out[cur][2].n > 0;
+        if (round_barrier_wait(&bs->barrier, active)) pair_step = false;
+        else if (pair_step || !bs->s->pair_rules) break;
+        else pair_step = true;
+    }
+    stats_flush();
+    THREAD_RETURN;
+}
+
+/* band_split
+   - Делит строки поля на nb полос не тоньше min_rows. Граница полосы — строка r,
+     у которой (r + 1) * w кратно 8, то есть строка начинается с целого байта
+     битовых множеств. Возвращает получившееся число полос (1, если делить нельзя).
+*/
+static int band_split(SolverBand* bands, int nb, int rows, int w, int min_rows) {
+    int g = 1; /* границы — строки r с (r + 1) % g == 0 */
+    while ((long long)g * w % 8 != 0) ++g;
+    for (; nb > 1; --nb) {
+        bool ok = true;
+        for (int t = 0; t < nb && ok; ++t) {
+            int r = (int)((long long)rows * (t + 1) / nb);
+            bands[t].r0 = t == 0 ? 0 : bands[t - 1].r1;
+            bands[t].r1 = t == nb - 1 ? rows : (r + 1) / g * g - 1;
+            ok = bands[t].r1 - bands[t].r0 >= min_rows;
+        }
+        if (ok) return nb;
+    }
+    bands[0].r0 = 0;
+    bands[0].r1 = rows;
+    return 1;
+}
+
+/* solver_bands_run
+   - Как solver_ctx_run, но на threads потоках (полосы строк, см. выше); число
+     потоков уменьшается так, чтобы полоса была не тоньше PAR_MIN_BAND_ROWS,
+     а при одной полосе это просто solver_ctx_run.
+   - Работает на массивах контекста s, привязанного к f solver_ctx_bind; после
+     запуска open и opened в контексте такие же, как после solver_ctx_run.
+   - Возвращает true, если открыты все безопасные клетки. При нехватке памяти
+     возвращает false.
+*/
+bool solver_bands_run(SolverCtx* s, const Field* f, int start_idx, int threads) {
+    int R = s->rows;
+    /* выводы правила C о соседях партнёра ложатся до трёх строк от своей клетки,
+       поэтому полоса не тоньше трёх строк — тогда адресат всегда в соседней полосе */
+    int min_rows = PAR_MIN_BAND_ROWS > 3 ? PAR_MIN_BAND_ROWS : 3;
+    int nb = threads;
+    if (nb > R / min_rows) nb = R / min_rows;
+    if (nb <= 1) return solver_ctx_run(s, f, start_idx);
+
+    solver_ctx_reset(s);
+    if (field_mine(f, start_idx)) return false;
+    STAT_ADD(solver_runs, 1);
+
+    BandSolver bs;
+    memset(&bs, 0, sizeof(bs));
+    bs.s = s;
+    bs.start = solver_pad(s, start_idx);
+    bs.nbands = nb;
+    bs.bands = (SolverBand*)calloc(nb, sizeof(SolverBand));
+    thread_handle* handles = (thread_handle*)malloc(nb * sizeof(thread_handle));
+    bool ok = bs.bands && handles;
+
+    if (ok) {
+        mutex_init(&bs.barrier.lock);
+        cond_init(&bs.barrier.wake);
+        for (int t = 0; t < nb; ++t) {
+            bs.bands[t].bs = &bs;
+            bs.bands[t].index = t;
+        }
+        /* барьер ждёт все полосы, поэтому их столько, сколько потоков удалось запустить */
+        int started = 0;
+        while (started + 1 < nb && thread_start(&handles[started + 1], band_worker, &bs.bands[started + 1])) ++started;
+        mutex_lock(&bs.barrier.lock);
+        nb = bs.nbands = band_split(bs.bands, started + 1, R, s->w, min_rows);
+        for (int t = 0; t < nb; ++t) {
+            bs.bands[t].lo = (bs.bands[t].r0 + 1) * s->w;
+            bs.bands[t].hi = (bs.bands[t].r1 + 1) * s->w;
+        }
+        bs.barrier.count = nb;
+        bs.go = true;
+        cond_broadcast(&bs.barrier.wake);
+        mutex_unlock(&bs.barrier.lock);
+
+        band_worker(&bs.bands[0]);
+        for (int t = 1; t <= started; ++t) thread_join(handles[t]);
+        cond_destroy(&bs.barrier.wake);
+        mutex_destroy(&bs.barrier.lock);
+    }
+
+    /* журнал changed полосы не ведут — следующий сброс будет полным */
+    s->full_reset = true;
+    s->oom = !ok;
+    for (int t = 0; ok && t < nb; ++t) {
+        s->opened += bs.bands[t].opened;
+        if (bs.bands[t].oom) s->oom = true;
+    }
+    for (int t = 0; bs.bands && t < bs.nbands; ++t) {
+        intvec_free(&bs.bands[t].work);
+        intvec_free(&bs.bands[t].pair_work);
+        for (int k = 0; k < 6; ++k) free(bs.bands[t].out[k / 3][k % 3].a);
+    }
+    free(handles);
+    free(bs.bands);
+    return !s->oom && s->opened == s->safe_total;
+}
+
+/* DEFINE_ONESHOT_PRESET
+   - Разовый запуск солвера для поля PR x PC без обращений к куче: все массивы
+     контекста — на стеке, с размерами-константами, а сам запуск — специализация
+     solver_ctx_run_RxC (DEFINE_SOLVER_PRESET). Ёмкость очередей равна числу
+     клеток: клетка стоит в work и pair_work не более одного раза одновременно и
+     попадает в changed не более одного раза за запуск, так что intvec_push эти
+     буферы никогда не расширяет (и контекст не нужно освобождать).
+   - failed и zones не нужны для одного запуска и остаются пустыми.
+*/
+#define DEFINE_ONESHOT_PRESET(PR, PC)                                              \
+static bool solver_oneshot_##PR##x##PC(const Field* f, int start_idx) {           \
+    enum { N = PR * PC, PN = (PR + 2) * (PC + 2), BITS = (PN + 7) / 8 };           \
+    unsigned char open[BITS], inferred_mine[BITS], queued[BITS], pair_queued[BITS];\
+    unsigned char nbr[PN], num[PN];                                                \
+    int work[N], pair_work[N], changed[N];                                         \
+    SolverCtx s;                                                                   \
+    memset(&s, 0, sizeof(s));                                                      \
+    solver_ctx_init_dims(&s, PR, PC);                                              \
+    s.open = open;                                                                 \
+    s.inferred_mine = inferred_mine;                                               \
+    s.queued = queued;                                                             \
+    s.pair_queued = pair_queued;                                                   \
+    s.nbr = nbr;                                                                   \
+    s.num = num;                                                                   \
+    s.work.a = work; s.work.cap = N;                                               \
+    s.pair_work.a = pair_work; s.pair_work.cap = N;                                \
+    s.changed.a = changed; s.changed.cap = N;                                      \
+    memset(num, NUM_BORDER, sizeof(num));                                          \
+    solver_ctx_clear_all(&s);                                                      \
+    solver_ctx_bind(&s, f);                                                        \
+    return solver_ctx_run_##PR##x##PC(&s, f, start_idx);                           \
+}
+FIELD_PRESETS(DEFINE_ONESHOT_PRESET)
+#undef DEFINE_ONESHOT_PRESET
+
+   /* simulate_solver_from
+      - Пытаемся логически раскрыть всё поле, начиная со start_r,start_c.
+      - Возвращает true, если все безопасные клетки можно открыть, применяя только локальную логику.
+      - Разовая обёртка над SolverCtx; при многократных вызовах на одном поле
+        выгоднее держать свой контекст и вызывать solver_ctx_run.
+      - Стандартные размеры (FIELD_PRESETS) решаются без выделения памяти.
+        Работает в вызывающем потоке; параллельный запуск — solver_bands_run
+        с явно заданным числом потоков.
+   */
+bool simulate_solver_from(const Field* f, int start_r, int start_c) {
+    if (!f) return false;
+
+    int start_idx = IDX(f, start_r, start_c);
+    if (field_mine(f, start_idx)) return false;
+#define ONESHOT_PRESET_CASE(PR, PC) \
+    if (f->rows == PR && f->cols == PC) return solver_oneshot_##PR##x##PC(f, start_idx);
+    FIELD_PRESETS(ONESHOT_PRESET_CASE)
+#undef ONESHOT_PRESET_CASE
+
+    SolverCtx* s = solver_ctx_create(f->rows, f->cols);
+    if (!s) return false;
+    solver_ctx_bind(s, f);
+    bool solved = solver_ctx_run(s, f, start_idx);
+    solver_ctx_free(s);
+
+    /* Возвращаем true только если открыты все безопасные клетки */
+    return solved;
+}
+
+/* ===================================================================
+   Классы эквивалентности стартовых клеток
+   =================================================================== */
+
+   /*
+     Если старт из клетки s' не привёл к полному решению, то и старт из любой клетки s,
+     открытой во время этой попытки, тоже не приведёт: всё, что выводится из s,
+     выводится и из s' (правила монотонны — новые факты не отменяют старых выводов).
+     В частности, все клетки одной нулевой области дают одинаковый результат.
+
+     Поэтому check_solvability:
+       - одним проходом размечает нулевые области (каждая — один класс);
+         каждая ненулевая неминная клетка — отдельный класс;
+       - пробует сначала самые большие нулевые области (они открывают больше всего),
+         затем ненулевые клетки;
+       - после неудачной попытки помечает неудачными все открытые клетки
+         (битовое множество failed — кэш результатов для этого поля),
+         так что каждый класс моделируется не более одного раза.
+   */
+
+   /* StartClass — класс стартовых клеток: представитель и размер (для нулевой области). */
+typedef struct StartClass {
+    int start; /* индекс клетки-представителя */
+    int size;  /* число клеток в классе */
+} StartClass;
+
+/* start_class_cmp — большие классы раньше; при равенстве — по индексу представителя. */
+static int start_class_cmp(const void* a, const void* b) {
+    const StartClass* x = (const StartClass*)a;
+    const StartClass* y = (const StartClass*)b;
+    if (x->size != y->size) return (x->size > y->size) ? -1 : 1;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+/* label_zero_regions
+   - Находит все нулевые области (8-связность) поля, привязанного solver_ctx_bind,
+     и записывает их представителей (индексы поля) и размеры в буфер s->zones
+     (растёт по мере надобности и переиспользуется).
+   - Обход идёт по сетке с рамкой: у рамки число NUM_BORDER, поэтому проверка
+     "сосед — нуль" заодно отсекает выход за край поля.
+   - Битовое множество s->failed служит здесь отметкой "уже обойдена" и после
+     разметки очищается; очередь s->work — стеком обхода.
+   - Возвращает число областей или -1 при ошибке выделения памяти.
+*/
+static int label_zero_regions(SolverCtx* s) {
+    int R = s->rows, C = s->cols, W = s->w;
+    unsigned char* seen = s->failed;
+    IntVec* stack = &s->work;
+    int k = 0;
+    bool ok = true;
+
+    memset(seen, 0, bitset_bytes(s->pn));
+    stack->n = 0;
+    for (int i = W + 1; i <= R * W + C && ok; ++i) {
+        if (s->num[i] != 0 || bit_get(seen, i)) continue;
+        if (k == s->zones_cap) {
+            int ncap = s->zones_cap ? s->zones_cap * 2 : 16;
+            StartClass* nc = (StartClass*)realloc(s->zones, ncap * sizeof(StartClass));
+            if (!nc) { ok = false; break; }
+            s->zones = nc;
+            s->zones_cap = ncap;
+        }
+        StartClass* z = &s->zones[k];
+        z->start = solver_unpad(s, i);
+        z->size = 0;
+
+        /* обход нулевой области */
+        bit_set(seen, i);
+        ok = intvec_push(stack, i);
+        while (ok && stack->n > 0) {
+            int cur = stack->a[--stack->n];
+            z->size++;
+            SOLVER_NEIGHBOURS(cur, W, p2, {
+                if (s->num[p2] == 0 && !bit_get(seen, p2)) {
+                    bit_set(seen, p2);
+                    if (!intvec_push(stack, p2)) ok = false;
+                    STAT_ADD(bfs_pushes, 1);
+                }
+            });
+        }
+        ++k;
+    }
+
+    stack->n = 0;
+    memset(seen, 0, bitset_bytes(s->pn));
+    return ok ? k : -1;
+}
+
+/* try_start
+   - Запускает солвер из клетки start. При неудаче помечает в s->failed все открытые клетки.
+   - Возвращает true, если поле решено.
+*/
+static bool try_start(SolverCtx* s, const Field* f, int start) {
+    bool solved = solver_ctx_run(s, f, start);
+    if (!solved && !s->oom) {
+        /* все открытые клетки тоже заведомо неудачные стартовые;
+           по журналу — за время, пропорциональное работе запуска */
+        if (s->full_reset) {
+            size_t bytes = bitset_bytes(s->pn);
+            for (size_t j = 0; j < bytes; ++j) s->failed[j] |= s->open[j];
+        }
+        else {
+            for (int k = 0; k < s->changed.n; ++k) {
+                int p = s->changed.a[k];
+                if (bit_get(s->open, p)) bit_set(s->failed, p);
+            }
+        }
+    }
+    return solved;
+}
+
+/*
+  check_solvability_ctx
+  - Перебирает классы стартовых клеток (см. выше) и вызывает солвер
+    для представителя каждого ещё не отброшенного класса.
+  - Все рабочие буферы берутся из контекста s (размеры должны совпадать с f),
+    так что повторные проверки новых полей того же размера не выделяют память.
+  - При первом успехе возвращает true и координаты стартовой клетки.
+  - Если ни одна стартовая клетка не дала полного решения, возвращает false.
+  - Запуски идут через solver_ctx_run, поэтому для размеров FIELD_PRESETS
+    работает специализация солвера (DEFINE_SOLVER_PRESET).
+*/
+bool check_solvability_ctx(const Field* f, SolverCtx* s, int* out_r, int* out_c) {
+    if (!f || !solver_ctx_bind(s, f)) return false;
+    int R = f->rows, C = f->cols, W = s->w;
+    STAT_TIME_BEGIN(t0);
+
+    int k = label_zero_regions(s);
+    if (k < 0) return false;
+    qsort(s->zones, k, sizeof(StartClass), start_class_cmp);
+
+    int solved_at = -1;
+
+    /* сначала нулевые области, от больших к меньшим */
+    for (int j = 0; j < k && solved_at < 0; ++j) {
+        int start = s->zones[j].start;
+        if (bit_get(s->failed, solver_pad(s, start))) continue;
+        if (try_start(s, f, start)) solved_at = start;
+    }
+    /* затем ненулевые клетки, не открытые ни одной неудачной попыткой */
+    for (int r = 1; r <= R && solved_at < 0; ++r)
+        for (int c = 1; c <= C && solved_at < 0; ++c) {
+            int q = r * W + c;
+            if (s->num[q] == NUM_MINE || bit_get(s->failed, q)) continue;
+            int i = (r - 1) * C + c - 1;
+            if (try_start(s, f, i)) solved_at = i;
+        }
+
+    if (solved_at >= 0) {
+        if (out_r) *out_r = solved_at / C;
+        if (out_c) *out_c = solved_at % C;
+    }
+    STAT_TIME_END(t_solve, t0);
+    return solved_at >= 0;
+}
+
+/*
+  check_solvability
+  - Разовая проверка: создаёт контекст под размер поля и вызывает check_solvability_ctx.
+*/
+bool check_solvability(const Field* f, int* out_r, int* out_c) {
+    if (!f) return false;
+    SolverCtx* s = solver_ctx_create(f->rows, f->cols);
+    if (!s) return false;
+    bool ok = check_solvability_ctx(f, s, out_r, out_c);
+    solver_ctx_free(s);
+    return ok;
+}
+
+/* ===================================================================
+   Генерация с исправлениями (--repair)
+   =================================================================== */
+
+   /*
+     Обычная генерация выбрасывает поле целиком, если солвер застрял. Здесь поле
+     сохраняется и исправляется точечно:
+       - старт — самая большая нулевая область (если нулей нет, мины из окрестности
+         центральной клетки переносятся, и она становится нулём);
+       - солвер запускается один раз; если он застрял, несколько мин с застрявшего
+         фронта (закрытые клетки рядом с открытыми) переносятся в случайные далёкие
+         клетки — закрытые и не соседние ни с одной открытой;
+       - счётчики 3x3 вокруг старого и нового места мины правятся за O(1)
+         (repair_set_mine) — в копии чисел солвера num, где у рамки NUM_BORDER,
+         восемью смещениями off[] без проверок границ, и в самом поле;
+         число мин не меняется;
+       - открытые клетки с изменившимся числом ставятся в очередь, и солвер
+         продолжает с того же состояния, без повторного запуска.
+
+     Почему продолжать можно: правила A и B срабатывают только у клеток, после
+     чего у них не остаётся закрытых соседей, поэтому переносимая мина (закрытая
+     клетка) никогда не соседствует с клеткой, уже давшей вывод, — все прежние
+     выводы остаются верными для нового поля. Правило C может оставить у клетки
+     закрытых соседей, поэтому при нём найденное решение проверяется одним
+     запуском с нуля. Если застрял не фронт, а закрытый участок за помеченными
+     минами, переносится помеченная мина и солвер запускается заново.
+   */
+
+   /* repair_set_mine
+      - Ставит (mine = true) или убирает мину в клетке q (индекс с рамкой): правит
+        числа соседей и самой клетки в s->num и в поле за O(1), f->mines меняется
+        соответственно; открытые клетки с изменившимся числом ставятся в очередь.
+      - Смещения соседей в поле (foff) идут в том же порядке, что s->off.
+   */
+static void repair_set_mine(Field* f, SolverCtx* s, int q, bool mine) {
+    if ((s->num[q] == NUM_MINE) == mine) return;
+    int C = s->cols, i = solver_unpad(s, q), own = 0;
+    const int foff[8] = { -C - 1, -C, -C + 1, -1, 1, C - 1, C, C + 1 };
+    field_set_mine(f, i, mine);
+    for (int k = 0; k < 8; ++k) {
+        int q2 = q + s->off[k];
+        unsigned char n = s->num[q2];
+        if (n == NUM_MINE) { ++own; continue; }
+        if (n == NUM_BORDER) continue;
+        s->num[q2] = (unsigned char)(mine ? n + 1 : n - 1);
+        field_set_count(f, i + foff[k], s->num[q2]);
+        if (bit_get(s->open, q2)) solver_push(s, q2);
+    }
+    s->num[q] = mine ? NUM_MINE : (unsigned char)own;
+    field_set_count(f, i, mine ? 0 : own); /* у мин счётчик 0 */
+    if (bit_get(s->open, q)) solver_push(s, q);
+    f->mines += mine ? 1 : -1;
+}
+
+/* repair_near_open — есть ли среди p (индекс поля) и его соседей открытая клетка. */
+static bool repair_near_open(const SolverCtx* s, int p) {
+    int q = solver_pad(s, p);
+    if (bit_get(s->open, q)) return true;
+    for (int k = 0; k < 8; ++k)
+        if (bit_get(s->open, q + s->off[k])) return true;
+    return false;
+}
+
+/* repair_pick_target
+   - Клетка для переносимой мины: не мина, не в окне 3x3 клетки avoid. Сначала
+     ищется далёкая закрытая клетка (не помечена и не рядом с открытыми) — случайными
+     пробами, затем перебором с случайного места. Если таких нет (открыто почти
+     всё поле), берётся открытая клетка, и *restart = true: состояние солвера
+     после такого переноса неверно, его нужно пересчитать с нуля.
+   - Возвращает -1, если подходящей клетки нет вовсе.
+*/
+static int repair_pick_target(const Field* f, const SolverCtx* s, Rng* rng, int avoid, bool* restart) {
+    int N = s->n, C = s->cols;
+    int ar = avoid / C, ac = avoid % C;
+    for (int t = 0; t < 64; ++t) {
+        int q = (int)(rng_next(rng) % (uint64_t)N);
+        if (field_mine(f, q) || bit_get(s->inferred_mine, solver_pad(s, q)) || repair_near_open(s, q)) continue;
+        if (abs(q / C - ar) <= 1 && abs(q % C - ac) <= 1) continue;
+        return q;
+    }
+    int base = (int)(rng_next(rng) % (uint64_t)N), fallback = -1;
+    for (int k = 0; k < N; ++k) {
+        int q = base + k < N ? base + k : base + k - N;
+        if (field_mine(f, q) || bit_get(s->inferred_mine, solver_pad(s, q))) continue;
+        if (abs(q / C - ar) <= 1 && abs(q % C - ac) <= 1) continue;
+        if (!repair_near_open(s, q)) return q;
+        if (fallback < 0 && bit_get(s->open, solver_pad(s, q))) fallback = q;
+    }
+    if (fallback >= 0) *restart = true;
+    return fallback;
+}
+
+/* repair_move_mine — переносит мину from -> to (индексы поля) в поле и в копии
+   чисел солвера (num), ставит в очередь открытые клетки с изменившимся числом. */
+static void repair_move_mine(Field* f, SolverCtx* s, int from, int to) {
+    repair_set_mine(f, s, solver_pad(s, from), false);
+    repair_set_mine(f, s, solver_pad(s, to), true);
+    STAT_ADD(repair_moves, 1);
+}
+
+/* repair_collect — мины на застрявшем фронте: закрытые непомеченные соседи
+   открытых клеток; при inferred = true — помеченные мины рядом с закрытыми клетками.
+   В out попадают индексы поля. */
+static void repair_collect(SolverCtx* s, IntVec* out, bool inferred) {
+    size_t bytes = bitset_bytes(s->pn);
+    const unsigned char* from = inferred ? s->inferred_mine : s->open;
+    out->n = 0;
+    for (size_t w = 0; w < bytes; ++w) {
+        if (!from[w]) continue;
+        for (int b = 0; b < 8; ++b) {
+            int p = (int)(w * 8 + b);
+            if (p >= s->pn || !bit_get(from, p) || s->num[p] == NUM_BORDER ||
+                NBR_UNKNOWN(s->nbr[p]) == 0) continue;
+            if (inferred) { if (!intvec_push(out, solver_unpad(s, p))) s->oom = true; continue; }
+            for (int k = 0; k < 8; ++k) {
+                int q = p + s->off[k];
+                /* queued пуст, пока солвер стоит, — используем его как отметку "уже в списке" */
+                if (s->num[q] != NUM_MINE || bit_get(s->open, q) || bit_get(s->inferred_mine, q) ||
+                    bit_get(s->queued, q)) continue;
+                bit_set(s->queued, q);
+                if (!intvec_push(out, solver_unpad(s, q))) s->oom = true;
+            }
+        }
+    }
+    if (!inferred) for (int k = 0; k < out->n; ++k) bit_clear(s->queued, solver_pad(s, out->a[k]));
+}
+
+/* generate_repair
+   - Генерирует поле (generate_board: percent% или ровно mines мин) и исправляет его переносом мин
+     (см. выше), пока солвер не откроет всё из стартовой клетки или не будет
+     сделано max_moves переносов (max_moves <= 0 — число мин + 64).
+   - s — контекст солвера под размер поля; rng задаёт и поле, и переносы.
+   - При успехе возвращает true и стартовую клетку; *out_moves — число переносов.
+*/
+bool generate_repair(Field* f, double percent, int mines, Rng* rng, SolverCtx* s, int max_moves,
+    int* out_r, int* out_c, int* out_moves) {
+    if (!f || !s) return false;
+    generate_board(f, percent, mines, rng, -1, -1);
+    if (!solver_ctx_bind(s, f)) return false;
+    int R = f->rows, C = f->cols, moves = 0;
+    if (max_moves <= 0) max_moves = f->mines + 64;
+
+    /* стартовая клетка */
+    int k = label_zero_regions(s);
+    if (k < 0) return false;
+    int start = -1, best = 0;
+    for (int j = 0; j < k; ++j)
+        if (s->zones[j].size > best) { best = s->zones[j].size; start = s->zones[j].start; }
+    if (start < 0) {
+        /* нулей нет — расчищаем окрестность центра (у рамки num = NUM_BORDER);
+           клетки окна — по строкам, как раньше, чтобы seed давал то же поле */
+        start = IDX(f, R / 2, C / 2);
+        int q0 = solver_pad(s, start);
+        for (int k = 0; k < 9; ++k) {
+            int q = k == 4 ? q0 : q0 + s->off[k < 4 ? k : k - 1];
+            if (s->num[q] != NUM_MINE) continue;
+            bool unused = false;
+            int to = repair_pick_target(f, s, rng, start, &unused);
+            if (to < 0) return false; /* поле почти целиком из мин */
+            repair_move_mine(f, s, solver_unpad(s, q), to);
+            ++moves;
+        }
+    }
+
+    IntVec cand = { NULL, 0, 0 };
+    bool ok = false;
+    bool fresh = true; /* состояние солвера совпадает с запуском с нуля */
+    solver_ctx_run(s, f, start);
+    for (;;) {
+        if (!s->oom && s->opened == s->safe_total) {
+            if (fresh) { ok = true; break; }
+            solver_ctx_run(s, f, start); /* проверка после правила C */
+            fresh = true;
+            continue;
+        }
+        if (s->oom || moves >= max_moves) break;
+
+        repair_collect(s, &cand, false);
+        bool restart = false;
+        if (cand.n == 0) {
+            /* фронт без мин — закрытый участок отгорожен помеченными минами */
+            repair_collect(s, &cand, true);
+            restart = true;
+        }
+        if (s->oom || cand.n == 0) break;
+
+        /* переносим 1 + n/8 случайных мин фронта */
+        int batch = 1 + cand.n / 8, done = 0;
+        for (int j = 0; j < batch && j < cand.n; ++j) {
+            int pick = j + (int)(rng_next(rng) % (uint64_t)(cand.n - j));
+            int from = cand.a[pick];
+            cand.a[pick] = cand.a[j];
+            int to = repair_pick_target(f, s, rng, start, &restart);
+            if (to < 0) break;
+            repair_move_mine(f, s, from, to);
+            ++done;
+        }
+        if (done == 0) break;
+        moves += done;
+
+        if (restart) { solver_ctx_run(s, f, start); fresh = true; }
+        else {
+            solver_propagate(s); /* продолжаем с того же состояния */
+            fresh = !s->pair_rules;
+        }
+    }
+
+    intvec_free(&cand);
+    if (ok) {
+        if (out_r) *out_r = start / C;
+        if (out_c) *out_c = start % C;
+    }
+    if (out_moves) *out_moves = moves;
+    return ok;
+}
+
+/* ===================================================================
+   Оценка сложности поля
+   =================================================================== */
+
+   /*
+     Сложность поля — сколько и какой логики требует его решение из стартовой клетки:
+       - ярус правил (tier): 1 — хватает правил A и B, 2 — нужны пары чисел
+         (правило C), 3 — нужен перебор конфигураций фронта;
+       - раунды (rounds): сколько раз правила A и B доходили до неподвижной точки
+         (каждый раунд, кроме первого, начинается с вывода старшего яруса);
+       - наибольший фронт (max_frontier): закрытые непомеченные клетки рядом с
+         открытыми в моменты, когда A и B остановились.
+     Оценка идёт ярусами: A и B до неподвижной точки, затем один проход правила C
+     по всем открытым клеткам фронта и, если он ничего не дал, перебор.
+
+     Перебор. Фронт делится на независимые компоненты связности: закрытые
+     непомеченные клетки (переменные) связаны, если соседствуют с общей открытой
+     клеткой-ограничением. Все закрытые соседи ограничения лежат в его компоненте,
+     поэтому компоненты перебираются отдельно — перебор с возвратом и отсечением
+     по ограничениям. Клетка, которая во всех допустимых конфигурациях компоненты
+     мина (или во всех безопасна), выводится.
+
+     Результат перебора зависит только от формы компоненты: относительных
+     координат переменных и ограничений и оставшегося у ограничений числа мин.
+     Он запоминается в таблице (ScoreMemo) по этой сигнатуре, так что компоненты,
+     не изменившиеся между раундами, и одинаковые шаблоны на разных полях
+     перебираются один раз на контекст (на поток пакетного режима).
+   */
+#define SCORE_MAX_VARS 24          /* компоненты крупнее не перебираются */
+#define SCORE_MAX_CONS 64          /* ... как и компоненты с большим числом ограничений */
+#define SCORE_MAX_NODES (1 << 20)  /* предел узлов перебора одной компоненты */
+#define SCORE_MEMO_SLOTS 2048      /* размер таблицы запоминания (степень двойки) */
+#define SCORE_SIG_MAX (1 + 2 * SCORE_MAX_VARS + 3 * SCORE_MAX_CONS)
+
+/* BoardScore — сложность поля (см. выше). */
+typedef struct {
+    bool solved;        /* всё открыто из стартовой клетки, с перебором включительно */
+    int tier;           /* старший понадобившийся ярус правил, 1..3 */
+    int rounds;         /* проходов A и B до неподвижной точки */
+    int max_frontier;   /* наибольший фронт при остановке A и B */
+    int max_component;  /* наибольшая перебранная компонента фронта (0 — перебора не было) */
+    long long configs;  /* сумма допустимых конфигураций перебранных компонент */
+} BoardScore;
+
+/* ScoreMemoEntry — запомненный итог перебора компоненты с данной сигнатурой. */
+typedef struct {
+    uint64_t hash;
+    int len;                               /* длина сигнатуры; 0 — ячейка пуста */
+    unsigned char sig[SCORE_SIG_MAX];
+    unsigned char verdict[SCORE_MAX_VARS]; /* 0 — неизвестно, 1 — безопасна, 2 — мина */
+    long long configs;                     /* 0 — перебор прерван по SCORE_MAX_NODES */
+} ScoreMemoEntry;
+
+/* ScoreComp — компонента фронта и рабочие массивы её перебора. */
+typedef struct {
+    int nv, nc;
+    int var[SCORE_MAX_VARS];           /* переменные: индексы с рамкой, по возрастанию */
+    int con[SCORE_MAX_CONS];           /* ограничения: индексы с рамкой, по возрастанию */
+    int need[SCORE_MAX_CONS];          /* сколько мин ещё нужно ограничению */
+    int left[SCORE_MAX_CONS];          /* сколько его переменных ещё не назначено */
+    int deg[SCORE_MAX_VARS];           /* число ограничений у переменной */
+    unsigned char adj[SCORE_MAX_VARS][8]; /* номера ограничений переменной */
+    unsigned char val[SCORE_MAX_VARS];
+    long long mines[SCORE_MAX_VARS];   /* в скольких конфигурациях переменная — мина */
+    long long configs, nodes;
+} ScoreComp;
+
+/* ScoreCtx — контекст оценки: солвер под размер поля, таблица запоминания
+   и рабочие буферы; переиспользуется для многих полей одного размера. */
+typedef struct {
+    SolverCtx* s;          /* солвер только с правилами A и B */
+    ScoreMemoEntry* memo;  /* SCORE_MEMO_SLOTS ячеек */
+    int* mark;             /* номер компоненты клетки (индексы с рамкой), -1 — нет */
+    IntVec cons;           /* открытые клетки фронта текущего раунда */
+    IntVec queue;          /* обход компоненты */
+    IntVec found;          /* выводы перебора: клетка * 2 + (1 — мина) */
+    ScoreComp comp;
+    long long memo_hits, memo_misses;
+} ScoreCtx;
+
+void score_ctx_free(ScoreCtx* sc) {
+    if (!sc) return;
+    solver_ctx_free(sc->s);
+    free(sc->memo);
+    free(sc->mark);
+    intvec_free(&sc->cons);
+    intvec_free(&sc->queue);
+    intvec_free(&sc->found);
+    free(sc);
+}
+
+/* score_ctx_create — контекст оценки для полей rows x cols; NULL при ошибке. */
+ScoreCtx* score_ctx_create(int rows, int cols) {
+    ScoreCtx* sc = (ScoreCtx*)calloc(1, sizeof(ScoreCtx));
+    if (!sc) return NULL;
+    sc->s = solver_ctx_create(rows, cols);
+    sc->memo = (ScoreMemoEntry*)calloc(SCORE_MEMO_SLOTS, sizeof(ScoreMemoEntry));
+    if (sc->s) sc->mark = (int*)malloc(sc->s->pn * sizeof(int));
+    if (!sc->s || !sc->memo || !sc->mark) { score_ctx_free(sc); return NULL; }
+    sc->s->pair_rules = false; /* ярусы выше A и B оценка применяет сама */
+    memset(sc->s->failed, 0, bitset_bytes(sc->s->pn)); /* отметки фронта, см. score_collect_frontier */
+    for (int i = 0; i < sc->s->pn; ++i) sc->mark[i] = -1;
+    return sc;
+}
+
+/* score_collect_frontier — открытые клетки с закрытыми непомеченными соседями
+   в sc->cons; возвращает размер фронта (число таких соседей). */
+static int score_collect_frontier(ScoreCtx* sc) {
+    SolverCtx* s = sc->s;
+    unsigned char* seen = s->failed; /* свободен: оценка не ищет стартовые клетки */
+    size_t bytes = bitset_bytes(s->pn);
+    int frontier = 0;
+    sc->cons.n = 0;
+    for (size_t w = 0; w < bytes; ++w) {
+        if (!s->open[w]) continue;
+        for (int b = 0; b < 8; ++b) {
+            int p = (int)(w * 8 + b);
+            if (p >= s->pn || !bit_get(s->open, p) || NBR_UNKNOWN(s->nbr[p]) == 0) continue;
+            if (!intvec_push(&sc->cons, p)) s->oom = true;
+            for (int k = 0; k < 8; ++k) {
+                int q = p + s->off[k];
+                if (bit_get(s->open, q) || bit_get(s->inferred_mine, q) || bit_get(seen, q)) continue;
+                bit_set(seen, q);
+                ++frontier;
+            }
+        }
+    }
+    memset(seen, 0, bytes);
+    return frontier;
+}
+
+/* score_pairs — один проход правила C по клеткам фронта; true, если что-то выведено. */
+static bool score_pairs(ScoreCtx* sc) {
+    bool progress = false;
+    for (int k = 0; k < sc->cons.n; ++k)
+        if (solver_pair_check(sc->s, sc->cons.a[k])) progress = true;
+    return progress;
+}
+
+static int int_cmp(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/* score_build_comp — компонента фронта, содержащая ограничение c0 (номер id в mark).
+   Возвращает false, если она больше SCORE_MAX_VARS / SCORE_MAX_CONS (тогда
+   mark всё равно проставлен у всех её клеток, чтобы не обходить её повторно). */
+static bool score_build_comp(ScoreCtx* sc, int c0, int id) {
+    SolverCtx* s = sc->s;
+    ScoreComp* cp = &sc->comp;
+    bool fits = true;
+    cp->nv = cp->nc = 0;
+    sc->queue.n = 0;
+    sc->mark[c0] = id;
+    if (!intvec_push(&sc->queue, c0)) { s->oom = true; return false; }
+    /* в очереди — ограничения; переменные записываются по ходу обхода */
+    for (int h = 0; h < sc->queue.n; ++h) {
+        int c = sc->queue.a[h];
+        if (cp->nc < SCORE_MAX_CONS) cp->con[cp->nc] = c;
+        else fits = false;
+        cp->nc++;
+        for (int k = 0; k < 8; ++k) {
+            int v = c + s->off[k];
+            if (bit_get(s->open, v) || bit_get(s->inferred_mine, v) || sc->mark[v] == id) continue;
+            sc->mark[v] = id;
+            if (cp->nv < SCORE_MAX_VARS) cp->var[cp->nv] = v;
+            else fits = false;
+            cp->nv++;
+            for (int j = 0; j < 8; ++j) {
+                int c2 = v + s->off[j];
+                if (!bit_get(s->open, c2) || NBR_UNKNOWN(s->nbr[c2]) == 0 || sc->mark[c2] == id) continue;
+                sc->mark[c2] = id;
+                if (!intvec_push(&sc->queue, c2)) { s->oom = true; return false; }
+            }
+        }
+    }
+    return fits;
+}
+
+/* score_signature — сигнатура компоненты: nv, затем (dr, dc) переменных и
+   (dr, dc, need) ограничений относительно левого верхнего угла компоненты.
+   Компонента связна через окна 3x3, поэтому её размах меньше 2 * (nv + 1)
+   и смещения помещаются в байт. Заполняет need; возвращает длину. */
+static int score_signature(ScoreCtx* sc, unsigned char* sig) {
+    SolverCtx* s = sc->s;
+    ScoreComp* cp = &sc->comp;
+    int W = s->w, r0 = INT32_MAX, c0 = INT32_MAX, len = 0;
+    qsort(cp->var, cp->nv, sizeof(int), int_cmp);
+    qsort(cp->con, cp->nc, sizeof(int), int_cmp);
+    for (int k = 0; k < cp->nv; ++k) {
+        if (cp->var[k] / W < r0) r0 = cp->var[k] / W;
+        if (cp->var[k] % W < c0) c0 = cp->var[k] % W;
+    }
+    for (int k = 0; k < cp->nc; ++k) {
+        if (cp->con[k] / W < r0) r0 = cp->con[k] / W;
+        if (cp->con[k] % W < c0) c0 = cp->con[k] % W;
+    }
+    sig[len++] = (unsigned char)cp->nv;
+    for (int k = 0; k < cp->nv; ++k) {
+        sig[len++] = (unsigned char)(cp->var[k] / W - r0);
+        sig[len++] = (unsigned char)(cp->var[k] % W - c0);
+    }
+    for (int k = 0; k < cp->nc; ++k) {
+        int c = cp->con[k];
+        cp->need[k] = s->num[c] - NBR_INFERRED(s->nbr[c]);
+        sig[len++] = (unsigned char)(c / W - r0);
+        sig[len++] = (unsigned char)(c % W - c0);
+        sig[len++] = (unsigned char)cp->need[k];
+    }
+    return len;
+}
+
+/* score_enum_rec — перебор с возвратом: назначает переменную k и проверяет её ограничения. */
+static void score_enum_rec(ScoreComp* cp, int k) {
+    if (++cp->nodes > SCORE_MAX_NODES) return;
+    if (k == cp->nv) {
+        cp->configs++;
+        for (int j = 0; j < cp->nv; ++j) cp->mines[j] += cp->val[j];
+        return;
+    }
+    for (int v = 0; v <= 1; ++v) {
+        bool ok = true;
+        for (int j = 0; j < cp->deg[k]; ++j) {
+            int c = cp->adj[k][j];
+            cp->left[c]--;
+            cp->need[c] -= v;
+            if (cp->need[c] < 0 || cp->need[c] > cp->left[c]) ok = false;
+        }
+        cp->val[k] = (unsigned char)v;
+        if (ok) score_enum_rec(cp, k + 1);
+        for (int j = 0; j < cp->deg[k]; ++j) {
+            int c = cp->adj[k][j];
+            cp->left[c]++;
+            cp->need[c] += v;
+        }
+        if (cp->nodes > SCORE_MAX_NODES) return;
+    }
+}
+
+/* score_enumerate — перебирает компоненту sc->comp (после score_signature) в запись memo. */
+static void score_enumerate(ScoreCtx* sc, ScoreMemoEntry* e) {
+    ScoreComp* cp = &sc->comp;
+    int W = sc->s->w;
+    for (int c = 0; c < cp->nc; ++c) cp->left[c] = 0;
+    for (int k = 0; k < cp->nv; ++k) {
+        int rv = cp->var[k] / W, cv = cp->var[k] % W;
+        cp->deg[k] = 0;
+        cp->mines[k] = 0;
+        for (int c = 0; c < cp->nc; ++c)
+            if (abs(cp->con[c] / W - rv) <= 1 && abs(cp->con[c] % W - cv) <= 1) {
+                cp->adj[k][cp->deg[k]++] = (unsigned char)c;
+                cp->left[c]++;
+            }
+    }
+    cp->configs = cp->nodes = 0;
+    score_enum_rec(cp, 0);
+    bool done = cp->nodes <= SCORE_MAX_NODES && cp->configs > 0;
+    e->configs = done ? cp->configs : 0;
+    for (int k = 0; k < cp->nv; ++k)
+        e->verdict[k] = !done ? 0 : cp->mines[k] == 0 ? 1 : cp->mines[k] == cp->configs ? 2 : 0;
+}
+
+/* score_components — перебор компонент фронта (ярус 3): применяет все выводы,
+   обновляет max_component и configs; true, если что-то выведено. */
+static bool score_components(ScoreCtx* sc, BoardScore* out) {
+    SolverCtx* s = sc->s;
+    ScoreComp* cp = &sc->comp;
+    int ncomp = 0;
+    unsigned char sig[SCORE_SIG_MAX];
+    sc->found.n = 0;
+    for (int k = 0; k < sc->cons.n && !s->oom; ++k) {
+        int c0 = sc->cons.a[k];
+        if (sc->mark[c0] >= 0) continue;
+        if (!score_build_comp(sc, c0, ncomp++)) continue;
+
+        int len = score_signature(sc, sig);
+        uint64_t h = 0xCBF29CE484222325ULL; /* FNV-1a */
+        for (int j = 0; j < len; ++j) h = (h ^ sig[j]) * 0x100000001B3ULL;
+        ScoreMemoEntry* e = &sc->memo[h & (SCORE_MEMO_SLOTS - 1)];
+        if (e->len == len && e->hash == h && memcmp(e->sig, sig, len) == 0) sc->memo_hits++;
+        else {
+            sc->memo_misses++;
+            e->hash = h;
+            e->len = len;
+            memcpy(e->sig, sig, len);
+            score_enumerate(sc, e);
+        }
+        if (cp->nv > out->max_component) out->max_component = cp->nv;
+        out->configs += e->configs;
+
+        for (int j = 0; j < cp->nv; ++j)
+            if (e->verdict[j] && !intvec_push(&sc->found, cp->var[j] * 2 + (e->verdict[j] == 2)))
+                s->oom = true;
+    }
+    /* снимаем отметки (они стоят только у клеток фронта и их соседей) и лишь
+       затем применяем выводы — все компоненты строились по одному состоянию */
+    for (int k = 0; k < sc->cons.n; ++k) {
+        int c = sc->cons.a[k];
+        sc->mark[c] = -1;
+        for (int j = 0; j < 8; ++j) sc->mark[c + s->off[j]] = -1;
+    }
+    for (int k = 0; k < sc->found.n && !s->oom; ++k) {
+        int v = sc->found.a[k] >> 1;
+        if (sc->found.a[k] & 1) solver_mark_mine(s, v);
+        else solver_open_cell(s, v);
+    }
+    return sc->found.n > 0;
+}
+
+/* score_board
+   - Оценивает сложность поля f при старте из клетки start_idx (индекс поля),
+     см. BoardScore. Контекст sc должен быть создан под размер поля.
+   - Возвращает false, если старт — мина, размеры не совпадают или не хватило памяти.
+*/
+bool score_board(ScoreCtx* sc, const Field* f, int start_idx, BoardScore* out) {
+    memset(out, 0, sizeof(*out));
+    if (!sc || !f || !solver_ctx_bind(sc->s, f) || field_mine(f, start_idx)) return false;
+    SolverCtx* s = sc->s;
+    solver_ctx_run(s, f, start_idx);
+    out->tier = 1;
+    out->rounds = 1;
+    while (!s->oom && s->opened < s->safe_total) {
+        int frontier = score_collect_frontier(sc);
+        if (frontier > out->max_frontier) out->max_frontier = frontier;
+        int tier;
+        if (score_pairs(sc)) tier = 2;
+        else if (score_components(sc, out)) tier = 3;
+        else break;
+        if (tier > out->tier) out->tier = tier;
+        solver_propagate(s);
+        out->rounds++;
+    }
+    out->solved = !s->oom && s->opened == s->safe_total;
+    return !s->oom;
+}
+
+/* save_score_to_stream — строка сложности после поля:
+     "# score solved=1 tier=2 rounds=5 frontier=14 component=0 configs=0"
+   Загрузчик читает только rows строк поля, поэтому строка не мешает
+   load_field_from_file и --validate. */
+static bool save_score_to_stream(const BoardScore* sc, FILE* out) {
+    fprintf(out, "# score solved=%d tier=%d rounds=%d frontier=%d component=%d configs=%lld\n",
+        sc->solved ? 1 : 0, sc->tier, sc->rounds, sc->max_frontier, sc->max_component, sc->configs);
+    return !ferror(out);
+}
+
+/* save_field_with_score — save_field_to_file и строка сложности (score == NULL — без неё). */
+bool save_field_with_score(const Field* f, const char* fname, const BoardScore* score) {
+    if (!f || !fname) return false;
+    FILE* out = fopen(fname, "w");
+    if (!out) return false;
+
+    bool ok = save_field_to_stream(f, out);
+    if (ok && score) ok = save_score_to_stream(score, out);
+    if (fclose(out) != 0) ok = false;
+    return ok;
+}
+
+/* ===================================================================
+   Оценка доли решаемых полей и адаптивный бюджет попыток
+   =================================================================== */
+
+   /*
+     Для каждого набора параметров (rows, cols, плотность) ведётся счёт попыток
+     и решаемых полей: в памяти процесса, а с ключом --rate-table FILE — ещё и
+     в файле между запусками. По этим числам:
+       - перед генерацией печатается ожидаемое число попыток (1 / доля решаемых);
+       - генерация останавливается раньше MAX_ATTEMPTS, если решаемое поле очень
+         маловероятно: берётся верхняя 95%-я граница доли решаемых p_hi (граница
+         Уилсона по истории и уже сделанным попыткам) и попытки прекращаются,
+         когда даже при такой доле ожидаемое число попыток до успеха (1 / p_hi)
+         больше, чем их осталось в бюджете.
+     Доля решаемых почти не растёт с плотностью, поэтому граница для плотности d
+     берётся ещё и как наименьшая из границ записей того же размера с плотностью
+     не больше d: если 50% уже безнадёжны, 60% остановятся после первых попыток.
+     Меньше GEN_MIN_ATTEMPTS попыток не делается никогда — так таблица продолжает
+     учиться и ошибочная граница исправится.
+     Ранняя остановка зависит от накопленной истории, поэтому при повторе поля
+     по seed она выключается (иначе решаемое поле могло бы не найтись).
+     Правило C (--pair-rules) и исправление полей (--repair) сильно меняют долю
+     решаемых, поэтому режим генерации — тоже часть ключа: записи разных режимов
+     не смешиваются и не одалживают друг другу границы.
+   */
+#define GEN_MIN_ATTEMPTS 32
+#define RATE_Z 1.645          /* односторонние 95% */
+#define RATE_TABLE_MAX 4096
+
+enum { RATE_MODE_PAIR = 1, RATE_MODE_REPAIR = 2 }; /* режим генерации: биты ключа */
+
+/* RateEntry — статистика попыток для одного набора параметров. */
+typedef struct {
+    int rows, cols;
+    double percent;
+    int mines;                /* >= 0 — точное число мин, иначе percent */
+    int mode;                 /* RATE_MODE_* */
+    long long trials, solved;
+} RateEntry;
+
+/* RateTable — таблица долей решаемых; path != NULL — сохраняется в файл. */
+typedef struct {
+    RateEntry* e;
+    int n, cap;
+    const char* path;
+} RateTable;
+
+static RateTable rate_table;
+
+/* rate_upper_bound — верхняя граница Уилсона для доли solved / trials (1 без данных). */
+static double rate_upper_bound(long long trials, long long solved) {
+    if (trials <= 0) return 1.0;
+    double n = (double)trials, s = (double)solved, z2 = RATE_Z * RATE_Z;
+    double hi = (s + z2 / 2 + RATE_Z * sqrt(s * (n - s) / n + z2 / 4)) / (n + z2);
+    return hi < 1.0 ? hi : 1.0;
+}
+
+/* rate_mine_fraction — доля мин для сравнения плотностей разных видов. */
+static double rate_mine_fraction(int rows, int cols, double percent, int mines) {
+    return mines >= 0 ? (double)mines / ((double)rows * cols) : percent / 100.0;
+}
+
+/* rate_mode_names — режимы в файле таблицы; rate_mode_parse — обратно (-1 — неизвестный). */
+static const char* const rate_mode_names[] = { "basic", "pair", "repair", "pair+repair" };
+
+static int rate_mode_parse(const char* s) {
+    for (int m = 0; m < 4; ++m)
+        if (strcmp(s, rate_mode_names[m]) == 0) return m;
+    return -1;
+}
+
+/* rate_table_find — запись для параметров; при create — новая пустая (NULL без памяти). */
+static RateEntry* rate_table_find(RateTable* t, int rows, int cols, double percent, int mines, int mode, bool create) {
+    for (int k = 0; k < t->n; ++k) {
+        RateEntry* e = &t->e[k];
+        if (e->rows == rows && e->cols == cols && e->mode == mode && e->mines == mines &&
+            (mines >= 0 || e->percent == percent))
+            return e;
+    }
+    if (!create || t->n >= RATE_TABLE_MAX) return NULL;
+    if (t->n == t->cap) {
+        int cap = t->cap ? t->cap * 2 : 32;
+        RateEntry* e = (RateEntry*)realloc(t->e, cap * sizeof(RateEntry));
+        if (!e) return NULL;
+        t->e = e;
+        t->cap = cap;
+    }
+    RateEntry* e = &t->e[t->n++];
+    e->rows = rows;
+    e->cols = cols;
+    e->percent = mines >= 0 ? 0 : percent;
+    e->mines = mines;
+    e->mode = mode;
+    e->trials = e->solved = 0;
+    return e;
+}
+
+/* rate_table_load
+   - Читает таблицу из файла: строки "ROWS COLS DENSITY TRIALS SOLVED [MODE]", DENSITY —
+     проценты или число мин с суффиксом m, MODE — basic, pair, repair или
+     pair+repair (без него — basic, как в таблицах до появления режимов);
+     '#' — комментарий.
+   - Отсутствующий файл — пустая таблица (она появится при первом сохранении).
+*/
+static bool rate_table_load(RateTable* t, const char* path) {
+    t->path = path;
+    FILE* in = fopen(path, "r");
+    if (!in) return true;
+    char line[128], dens[32], mode_name[16], extra[2];
+    long long rows, cols, trials, solved;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        double percent;
+        int mines, mode = 0;
+        int got = sscanf(line, "%lld %lld %31s %lld %lld %15s %1s", &rows, &cols, dens, &trials, &solved,
+            mode_name, extra);
+        if ((got != 5 && got != 6) || (got == 6 && (mode = rate_mode_parse(mode_name)) < 0) ||
+            rows <= 0 || cols <= 0 || rows * cols > INT32_MAX || trials < 0 || solved < 0 || solved > trials ||
+            !parse_density_arg(dens, rows * cols, &percent, &mines)) {
+            ok = false;
+            break;
+        }
+        RateEntry* e = rate_table_find(t, (int)rows, (int)cols, percent, mines, mode, true);
+        if (!e) ok = false;
+        else { e->trials += trials; e->solved += solved; }
+    }
+    fclose(in);
+    return ok;
+}
+
+/* rate_table_save — записывает таблицу в t->path (если задан). */
+static bool rate_table_save(const RateTable* t) {
+    if (!t->path) return true;
+    FILE* out = fopen(t->path, "w");
+    if (!out) return false;
+    fprintf(out, "# rows cols density trials solved mode\n");
+    for (int k = 0; k < t->n; ++k) {
+        const RateEntry* e = &t->e[k];
+        if (e->mines >= 0) fprintf(out, "%d %d %dm", e->rows, e->cols, e->mines);
+        else fprintf(out, "%d %d %.17g", e->rows, e->cols, e->percent);
+        fprintf(out, " %lld %lld %s\n", e->trials, e->solved, rate_mode_names[e->mode]);
+    }
+    return fclose(out) == 0;
+}
+
+/* GenBudget — адаптивный бюджет для generate_solvable_parallel (NULL — ровно max_attempts). */
+typedef struct {
+    long long prior_trials, prior_solved; /* история для этих параметров */
+    double borrowed_hi;                   /* граница по меньшим плотностям того же размера (1 — нет) */
+    int min_attempts;
+    /* итог запуска */
+    bool gave_up;                         /* остановлено досрочно */
+    int trials, solved;                   /* попытки этого запуска для таблицы */
+} GenBudget;
+
+/* gen_budget_prepare — заполняет бюджет из таблицы для параметров и режима генерации. */
+static void gen_budget_prepare(GenBudget* b, const RateTable* t, int rows, int cols, double percent, int mines,
+    int mode) {
+    memset(b, 0, sizeof(*b));
+    b->min_attempts = GEN_MIN_ATTEMPTS;
+    b->borrowed_hi = 1.0;
+    double frac = rate_mine_fraction(rows, cols, percent, mines);
+    for (int k = 0; k < t->n; ++k) {
+        const RateEntry* e = &t->e[k];
+        if (e->rows != rows || e->cols != cols || e->mode != mode) continue;
+        if (e->mines == mines && (mines >= 0 || e->percent == percent)) {
+            b->prior_trials = e->trials;
+            b->prior_solved = e->solved;
+        }
+        else if (rate_mine_fraction(rows, cols, e->percent, e->mines) <= frac) {
+            double hi = rate_upper_bound(e->trials, e->solved);
+            if (hi < b->borrowed_hi) b->borrowed_hi = hi;
+        }
+    }
+}
+
+/* gen_budget_rate_hi — верхняя граница доли решаемых после fails неудач этого запуска. */
+static double gen_budget_rate_hi(const GenBudget* b, long long fails) {
+    double hi = rate_upper_bound(b->prior_trials + fails, b->prior_solved);
+    return hi < b->borrowed_hi ? hi : b->borrowed_hi;
+}
+
+/* gen_budget_exhausted — пора ли сдаться после fails неудачных попыток из max_attempts. */
+static bool gen_budget_exhausted(const GenBudget* b, long long fails, int max_attempts) {
+    if (fails < b->min_attempts) return false;
+    return 1.0 / gen_budget_rate_hi(b, fails) > (double)(max_attempts - fails);
+}
+
+/* rate_table_record — добавляет итог запуска в таблицу и сохраняет её. */
+static void rate_table_record(RateTable* t, int rows, int cols, double percent, int mines, int mode,
+    const GenBudget* b) {
+    RateEntry* e = rate_table_find(t, rows, cols, percent, mines, mode, true);
+    if (!e) return;
+    e->trials += b->trials;
+    e->solved += b->solved;
+    if (!rate_table_save(t)) fprintf(stderr, "Не удалось сохранить таблицу %s\n", t->path);
+}
+
+/* ===================================================================
+   Параллельная генерация решаемого поля
+   =================================================================== */
+
+   /*
+     Попытки генерации независимы, поэтому их можно выполнять одновременно:
+       - каждый рабочий поток имеет своё поле Field;
+       - номера попыток раздаются атомарным счётчиком;
+       - поле попытки a строится из потока чисел rng_seed_attempt(master_seed, a);
+       - побеждает решаемая попытка с наименьшим номером. Как только она найдена,
+         потоки перестают брать попытки с большими номерами (отмена), но
+         дорабатывают меньшие — вдруг среди них тоже есть решаемая.
+     Итог зависит только от master_seed (и совпадает с последовательным перебором),
+     а не от числа потоков и планировщика.
+   */
+
+/* field_copy — копирует мины и счётчики поля src в поле dst того же размера и представления. */
+static void field_copy(Field* dst, const Field* src) {
+    memcpy(dst->is_mine, src->is_mine, field_mine_bytes(src));
+    memcpy(dst->count, src->count, field_count_bytes(src));
+    dst->mines = src->mines;
+}
+
+/* gen_repair_mode — попытка генерации исправляет поле (generate_repair), а не
+   выбрасывает его целиком (ключ --repair). */
+static bool gen_repair_mode = false;
+
+/* gen_rate_mode — текущий режим генерации для ключа таблицы долей (RATE_MODE_*). */
+static int gen_rate_mode(void) {
+    return (solver_pair_rules_default ? RATE_MODE_PAIR : 0) | (gen_repair_mode ? RATE_MODE_REPAIR : 0);
+}
+
+/* gen_start_r, gen_start_c — стартовая клетка (ключ --start R C), -1 — не задана.
+   Игра начинается с первого щелчка игрока, поэтому вместо поиска удачной
+   стартовой клетки (check_solvability, до N запусков солвера) попытка строит
+   поле без мин в окне 3x3 вокруг этой клетки — первое открытие всегда
+   раскрывает нулевую область — и запускает солвер один раз, из неё.
+   Поля, в которые клетка не помещается, генерируются как обычно. */
+static int gen_start_r = -1, gen_start_c = -1;
+
+/* GenJob — общее задание для всех рабочих потоков. */
+typedef struct {
+    int rows, cols;
+    double percent;
+    int mines;                  /* >= 0 — ровно столько мин вместо percent */
+    uint64_t master_seed;
+    int max_attempts;
+    volatile long next_attempt; /* следующий номер попытки для раздачи */
+    volatile long best_attempt; /* наименьший номер решаемой попытки (max_attempts — нет) */
+    GenBudget* budget;          /* адаптивный бюджет или NULL */
+    volatile long failures;     /* сколько попыток закончилось неудачей */
+    volatile long gave_up;      /* бюджет исчерпан досрочно: новых попыток не брать */
+    int start_r, start_c;       /* стартовая клетка (gen_start_r/c) или -1 */
+} GenJob;
+
+/* GenWorker — состояние одного рабочего потока. */
+typedef struct {
+    GenJob* job;
+    Field* field;      /* собственное поле потока */
+    SolverCtx* ctx;    /* контекст солвера потока: один на все его попытки */
+    int found_attempt; /* номер решаемой попытки этого потока или -1 */
+    int start_r, start_c;
+} GenWorker;
+
+/* gen_worker_run — цикл рабочего потока: берёт попытки, пока не найдено лучшее решение. */
+static THREAD_PROC(gen_worker_run) {
+    GenWorker* w = (GenWorker*)arg;
+    GenJob* job = w->job;
+    for (;;) {
+        if (atomic_load(&job->gave_up)) break;
+        long a = atomic_fetch_inc(&job->next_attempt);
+        if (a >= job->max_attempts || a > atomic_load(&job->best_attempt)) break;
+
+        Rng rng;
+        rng_seed_attempt(&rng, job->master_seed, (int)a);
+        bool ok;
+        if (job->start_r >= 0) {
+            /* безопасное окно у стартовой клетки и один запуск солвера из неё */
+            generate_board(w->field, job->percent, job->mines, &rng, job->start_r, job->start_c);
+            ok = solver_ctx_bind(w->ctx, w->field) &&
+                solver_ctx_run(w->ctx, w->field, IDX(w->field, job->start_r, job->start_c));
+            w->start_r = job->start_r;
+            w->start_c = job->start_c;
+        }
+        else if (gen_repair_mode)
+            ok = generate_repair(w->field, job->percent, job->mines, &rng, w->ctx, 0,
+                &w->start_r, &w->start_c, NULL);
+        else {
+            generate_board(w->field, job->percent, job->mines, &rng, -1, -1);
+            ok = check_solvability_ctx(w->field, w->ctx, &w->start_r, &w->start_c);
+        }
+        if (ok) {
+            w->found_attempt = (int)a;
+            atomic_min(&job->best_attempt, a);
+            break; /* все следующие попытки этого потока имели бы больший номер */
+        }
+        long fails = atomic_fetch_inc(&job->failures) + 1;
+        if (job->budget && atomic_load(&job->best_attempt) == job->max_attempts &&
+            gen_budget_exhausted(job->budget, fails, job->max_attempts))
+            atomic_cas(&job->gave_up, 0, 1);
+    }
+    stats_flush();
+    THREAD_RETURN;
+}
+
+/* generate_solvable_parallel
+   - Ищет решаемое поле за не более чем max_attempts попыток на threads потоках.
+   - mines >= 0 — в каждом поле ровно mines мин, иначе вероятность мины percent%.
+   - При успехе копирует поле в out, возвращает true и стартовую клетку;
+     в *out_attempts записывается номер удачной попытки + 1 (сколько попыток
+     понадобилось бы при последовательном переборе).
+   - При неудаче в out остаётся поле последней попытки вызывающего потока.
+   - budget (необязательно) — адаптивный бюджет: попытки прекращаются раньше,
+     если решаемое поле очень маловероятно; тогда *out_attempts — сколько попыток
+     сделано, а в budget записываются итоги запуска для таблицы долей.
+   - Если задана стартовая клетка (--start) и она помещается в поле, каждая
+     попытка — поле с безопасным окном вокруг неё и один запуск солвера
+     (см. gen_start_r); стартовой клеткой результата будет она.
+*/
+bool generate_solvable_parallel(Field* out, double percent, int mines, uint64_t master_seed, int threads,
+    int max_attempts, int* out_r, int* out_c, int* out_attempts, GenBudget* budget) {
+    if (!out || max_attempts <= 0) return false;
+    if (threads < 1) threads = 1;
+    if (threads > max_attempts) threads = max_attempts;
+
+    GenJob job;
+    job.rows = out->rows;
+    job.cols = out->cols;
+    job.percent = percent;
+    job.mines = mines;
+    job.master_seed = master_seed;
+    job.max_attempts = max_attempts;
+    job.next_attempt = 0;
+    job.best_attempt = max_attempts;
+    job.budget = budget;
+    job.failures = 0;
+    job.gave_up = 0;
+    bool anchored = gen_start_r >= 0 && gen_start_r < out->rows && gen_start_c >= 0 && gen_start_c < out->cols;
+    job.start_r = anchored ? gen_start_r : -1;
+    job.start_c = anchored ? gen_start_c : -1;
+
+    GenWorker* workers = (GenWorker*)calloc(threads, sizeof(GenWorker));
+    thread_handle* handles = (thread_handle*)malloc(threads * sizeof(thread_handle));
+    if (!workers || !handles) { free(workers); free(handles); return false; }
+
+    /* поток 0 — вызывающий, он работает прямо в out */
+    int started = 0;
+    for (int t = 0; t < threads; ++t) {
+        workers[t].job = &job;
+        workers[t].found_attempt = -1;
+        workers[t].field = (t == 0) ? out : field_create_ex(out->rows, out->cols, out->packed);
+        if (!workers[t].field) break;
+        workers[t].ctx = solver_ctx_create(out->rows, out->cols);
+        if (!workers[t].ctx || (t > 0 && !thread_start(&handles[t], gen_worker_run, &workers[t]))) {
+            solver_ctx_free(workers[t].ctx);
+            if (t > 0) field_free(workers[t].field);
+            workers[t].field = NULL;
+            break;
+        }
+        ++started;
+    }
+
+    if (started == 0) { free(workers); free(handles); return false; }
+    gen_worker_run(&workers[0]);
+    for (int t = 1; t < started; ++t) thread_join(handles[t]);
+
+    /* победитель — поток с наименьшим номером решаемой попытки */
+    int win = -1;
+    for (int t = 0; t < started; ++t)
+        if (workers[t].found_attempt >= 0 &&
+            (win < 0 || workers[t].found_attempt < workers[win].found_attempt))
+            win = t;
+
+    if (win >= 0) {
+        if (win != 0) field_copy(out, workers[win].field);
+        if (out_r) *out_r = workers[win].start_r;
+        if (out_c) *out_c = workers[win].start_c;
+        if (out_attempts) *out_attempts = workers[win].found_attempt + 1;
+    }
+    else if (out_attempts) *out_attempts = budget ? (int)job.failures : max_attempts;
+    if (budget) {
+        budget->gave_up = win < 0 && job.gave_up;
+        budget->trials = win >= 0 ? workers[win].found_attempt + 1 : (int)job.failures;
+        budget->solved = win >= 0;
+    }
+
+    for (int t = 0; t < started; ++t) {
+        solver_ctx_free(workers[t].ctx);
+        if (t > 0) field_free(workers[t].field);
+    }
+    free(workers);
+    free(handles);
+    return win >= 0;
+}
+
+/* ===================================================================
+   Пакетный (неинтерактивный) режим
+   =================================================================== */
+
+   /*
+     minesweeper --batch ROWS COLS DENSITY COUNT SEED OUT
+       - генерирует COUNT решаемых полей ROWSxCOLS с плотностью DENSITY%;
+       - поле номер k строится из seed derive_seed(SEED, k), поэтому весь набор
+         воспроизводим;
+       - OUT — существующий каталог (файлы board_000000.txt, ...) или "-" для stdout;
+         в файлы каталога после поля пишется строка сложности (score_board).
+
+     Работа устроена конвейером из трёх стадий (у каждой свои потоки), связанных
+     очередями ограниченной длины:
+       генерация + проверка решаемости (несколько потоков)
+         -> проверка счётчиков -> запись (в порядке номеров полей).
+     Поля (BatchItem) берутся из общего пула и возвращаются в него после записи,
+     поэтому запись на диск идёт одновременно с решением следующих полей, а
+     число полей в памяти ограничено размером пула.
+   */
+
+   /* BatchItem — одно поле, проходящее через конвейер. */
+typedef struct {
+    Field* field;
+    int index;      /* номер поля в наборе */
+    uint64_t seed;  /* master_seed этого поля */
+    int attempts;   /* сколько попыток понадобилось */
+    bool solvable;  /* найдено решаемое поле */
+    bool valid;     /* счётчики прошли проверку */
+    int start_r, start_c; /* стартовая клетка решения */
+    bool scored;    /* score посчитан */
+    BoardScore score;
+} BatchItem;
+
+/* BatchQueue — очередь ограниченной длины между стадиями конвейера. */
+typedef struct {
+    BatchItem** items;
+    int cap, head, size;
+    bool closed; /* писателей больше нет: pop вернёт NULL, когда очередь опустеет */
+    mutex_handle lock;
+    cond_handle not_empty, not_full;
+} BatchQueue;
+
+static bool batch_queue_init(BatchQueue* q, int cap) {
+    q->items = (BatchItem**)malloc(cap * sizeof(BatchItem*));
+    if (!q->items) return false;
+    q->cap = cap;
+    q->head = q->size = 0;
+    q->closed = false;
+    mutex_init(&q->lock);
+    cond_init(&q->not_empty);
+    cond_init(&q->not_full);
+    return true;
+}
+
+static void batch_queue_destroy(BatchQueue* q) {
+    free(q->items);
+    mutex_destroy(&q->lock);
+    cond_destroy(&q->not_empty);
+    cond_destroy(&q->not_full);
+}
+
+/* batch_queue_push — добавляет элемент, ожидая свободного места. */
+static void batch_queue_push(BatchQueue* q, BatchItem* it) {
+    mutex_lock(&q->lock);
+    while (q->size == q->cap) cond_wait(&q->not_full, &q->lock);
+    q->items[(q->head + q->size) % q->cap] = it;
+    q->size++;
+    cond_signal(&q->not_empty);
+    mutex_unlock(&q->lock);
+}
+
+/* batch_queue_pop — забирает элемент; NULL, если очередь закрыта и пуста. */
+static BatchItem* batch_queue_pop(BatchQueue* q) {
+    mutex_lock(&q->lock);
+    while (q->size == 0 && !q->closed) cond_wait(&q->not_empty, &q->lock);
+    BatchItem* it = NULL;
+    if (q->size > 0) {
+        it = q->items[q->head];
+        q->head = (q->head + 1) % q->cap;
+        q->size--;
+        cond_signal(&q->not_full);
+    }
+    mutex_unlock(&q->lock);
+    return it;
+}
+
+/* batch_queue_close — больше элементов не будет; будит всех ожидающих. */
+static void batch_queue_close(BatchQueue* q) {
+    mutex_lock(&q->lock);
+    q->closed = true;
+    cond_broadcast(&q->not_empty);
+    mutex_unlock(&q->lock);
+}
+
+/* BatchJob — параметры и общие очереди пакетного режима. */
+typedef struct {
+    int rows, cols, count;
+    double percent;
+    int mines;                 /* >= 0 — ровно столько мин вместо percent */
+    uint64_t seed;
+    const char* out;           /* каталог или "-" */
+    volatile long next_index;  /* следующий номер поля для генерации */
+    BatchQueue free_items;     /* пул свободных полей */
+    BatchQueue solved;         /* генерация -> проверка */
+    BatchQueue checked;        /* проверка -> запись */
+    BatchItem** pending;       /* поля, пришедшие на запись раньше своего номера */
+    /* итоги стадии записи */
+    int written, unsolvable, invalid, write_errors;
+    long long total_attempts;
+} BatchJob;
+
+/* batch_generate_stage — генерация и проверка решаемости (несколько потоков). */
+static THREAD_PROC(batch_generate_stage) {
+    BatchJob* job = (BatchJob*)arg;
+    /* сложность нужна только для файлов в каталоге; контекст (и таблица
+       запоминания перебора) — один на все поля потока */
+    ScoreCtx* sc = strcmp(job->out, "-") != 0 ? score_ctx_create(job->rows, job->cols) : NULL;
+    for (;;) {
+        /* сначала поле из пула, потом номер: так наименьший незаписанный номер
+           всегда находится у какого-то потока, и запись по порядку не застрянет */
+        BatchItem* it = batch_queue_pop(&job->free_items);
+        long k = atomic_fetch_inc(&job->next_index);
+        if (k >= job->count) { batch_queue_push(&job->free_items, it); break; }
+
+        it->index = (int)k;
+        it->seed = derive_seed(job->seed, (uint64_t)k);
+        it->solvable = generate_solvable_parallel(it->field, job->percent, job->mines, it->seed, 1,
+            MAX_ATTEMPTS, &it->start_r, &it->start_c, &it->attempts, NULL);
+        it->scored = it->solvable && sc &&
+            score_board(sc, it->field, IDX(it->field, it->start_r, it->start_c), &it->score);
+        batch_queue_push(&job->solved, it);
+    }
+    score_ctx_free(sc);
+    stats_flush();
+    THREAD_RETURN;
+}
+
+/* batch_validate_stage — проверка счётчиков решаемых полей. */
+static THREAD_PROC(batch_validate_stage) {
+    BatchJob* job = (BatchJob*)arg;
+    BatchItem* it;
+    while ((it = batch_queue_pop(&job->solved)) != NULL) {
+        it->valid = it->solvable && validate_field_ex(it->field, false);
+        batch_queue_push(&job->checked, it);
+    }
+    batch_queue_close(&job->checked);
+    stats_flush();
+    THREAD_RETURN;
+}
+
+/* batch_write_item — записывает одно поле в каталог или в stdout. */
+static bool batch_write_item(const BatchJob* job, const BatchItem* it) {
+    if (strcmp(job->out, "-") == 0) return save_field_to_stream(it->field, stdout);
+    char fname[1024];
+    snprintf(fname, sizeof(fname), "%s/board_%06d.txt", job->out, it->index);
+    return save_field_with_score(it->field, fname, it->scored ? &it->score : NULL);
+}
+
+/* batch_write_stage
+   - Записывает поля строго по возрастанию номера (вывод воспроизводим при любом
+     числе потоков); пришедшие раньше времени поля ждут своей очереди в pending.
+*/
+static THREAD_PROC(batch_write_stage) {
+    BatchJob* job = (BatchJob*)arg;
+    int npending = 0, next = 0;
+    BatchItem* it;
+    while ((it = batch_queue_pop(&job->checked)) != NULL) {
+        job->pending[npending++] = it;
+
+        for (int j = 0; j < npending;) {
+            BatchItem* cur = job->pending[j];
+            if (cur->index != next) { ++j; continue; }
+
+            job->total_attempts += cur->attempts;
+            if (!cur->solvable) job->unsolvable++;
+            else if (!cur->valid) job->invalid++;
+            else if (batch_write_item(job, cur)) job->written++;
+            else job->write_errors++;
+
+            job->pending[j] = job->pending[--npending];
+            ++next;
+            j = 0; /* следующий номер мог прийти раньше — ищем заново */
+            batch_queue_push(&job->free_items, cur);
+        }
+    }
+    THREAD_RETURN;
+}
+
+/* run_batch
+   - Разбирает аргументы пакетного режима, запускает конвейер и печатает итог
+     (в stderr, чтобы не смешивать его с полями при выводе в stdout).
+   - Возвращает код завершения программы.
+*/
+int run_batch(int argc, char** argv) {
+    long long rows, cols, count, seed;
+    double percent;
+    int mines;
+    if (argc != 8 || !parse_long_arg(argv[2], &rows) || !parse_long_arg(argv[3], &cols) ||
+        !parse_long_arg(argv[5], &count) || !parse_long_arg(argv[6], &seed) ||
+        rows <= 0 || cols <= 0 || count <= 0 || rows * cols > INT32_MAX || count > INT32_MAX ||
+        !parse_density_arg(argv[4], rows * cols, &percent, &mines)) {
+        fprintf(stderr, "Использование: %s --batch ROWS COLS DENSITY COUNT SEED OUT\n"
+            "  DENSITY — вероятность мины в процентах (можно дробную)\n"
+            "            или точное число мин с суффиксом m, например 99m,\n"
+            "  OUT     — существующий каталог или \"-\" для вывода в stdout.\n", argv[0]);
+        return 2;
+    }
+
+    BatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.rows = (int)rows;
+    job.cols = (int)cols;
+    job.percent = percent;
+    job.mines = mines;
+    job.count = (int)count;
+    job.seed = (uint64_t)seed;
+    job.out = argv[7];
+
+    int generators = cpu_count() - 2; /* ещё два потока — проверка и запись */
+    if (generators < 1) generators = 1;
+    if (generators > job.count) generators = job.count;
+    int pool_size = 2 * generators + 4;
+
+    BatchItem* items = (BatchItem*)calloc(pool_size, sizeof(BatchItem));
+    thread_handle* handles = (thread_handle*)malloc(generators * sizeof(thread_handle));
+    job.pending = (BatchItem**)malloc(pool_size * sizeof(BatchItem*));
+    bool ok = items && handles && job.pending;
+    ok = ok && batch_queue_init(&job.free_items, pool_size);
+    ok = ok && batch_queue_init(&job.solved, pool_size);
+    ok = ok && batch_queue_init(&job.checked, pool_size);
+    bool packed = (long long)job.rows * job.cols >= PACKED_MIN_CELLS;
+    for (int j = 0; ok && j < pool_size; ++j) {
+        items[j].field = field_create_ex(job.rows, job.cols, packed);
+        if (!items[j].field) ok = false;
+        else batch_queue_push(&job.free_items, &items[j]);
+    }
+
+    thread_handle validator, writer;
+    ok = ok && thread_start(&validator, batch_validate_stage, &job);
+    if (ok && !thread_start(&writer, batch_write_stage, &job)) {
+        batch_queue_close(&job.solved);
+        thread_join(validator);
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Не удалось подготовить пакетный режим (память или потоки).\n");
+        if (items) for (int j = 0; j < pool_size; ++j) field_free(items[j].field);
+        free(items); free(handles); free(job.pending);
+        return 1;
+    }
+
+    double t0 = now_seconds();
+    int started = 0;
+    for (int t = 0; t < generators; ++t)
+        if (thread_start(&handles[t], batch_generate_stage, &job)) ++started;
+    if (started == 0) batch_generate_stage(&job); /* без потоков — сами */
+    for (int t = 0; t < started; ++t) thread_join(handles[t]);
+
+    /* генерация закончена: закрываем конвейер по цепочке */
+    batch_queue_close(&job.solved);
+    thread_join(validator);
+    thread_join(writer);
+    double elapsed = now_seconds() - t0;
+
+    fflush(stdout);
+    fprintf(stderr, "Готово: записано %d из %d полей (не решено: %d, ошибок проверки: %d, ошибок записи: %d)\n",
+        job.written, job.count, job.unsolvable, job.invalid, job.write_errors);
+    fprintf(stderr, "Время: %.3f с, %.1f полей/с, в среднем %.1f попыток на поле\n",
+        elapsed, elapsed > 0 ? job.written / elapsed : 0.0,
+        (double)job.total_attempts / job.count);
+#ifdef MS_STATS
+    SolverStats st = stats_take();
+    stats_print(stderr, &st);
+#endif
+
+    for (int j = 0; j < pool_size; ++j) field_free(items[j].field);
+    batch_queue_destroy(&job.free_items);
+    batch_queue_destroy(&job.solved);
+    batch_queue_destroy(&job.checked);
+    free(items);
+    free(handles);
+    free(job.pending);
+    return (job.written == job.count) ? 0 : 1;
+}
+
+/* ===================================================================
+   Сервис готовых полей (--serve)
+   =================================================================== */
+
+   /*
+     minesweeper --serve [-j N] [--pool K] [--seed S]
+       Долго живущий процесс: читает запросы построчно из stdin и отвечает в stdout
+       (к UNIX-сокету или TCP его можно подключить через inetd/socat). Для каждого
+       набора параметров (ROWS, COLS, DENSITY) держится пул из K решаемых полей
+       (по умолчанию SERVE_POOL_DEFAULT), который N фоновых потоков (по умолчанию —
+       все ядра) пополняют, как только из него что-то взяли.
+
+     Запросы (DENSITY — проценты или число мин с суффиксом m, как в --batch):
+       GET ROWS COLS DENSITY  -> OK START_R START_C HIT|MISS МИКРОСЕКУНДЫ
+                                 и поле в текстовом формате (save_field_to_stream);
+                                 HIT — поле взято из пула, MISS — пул был пуст
+                                 и поле сгенерировано прямо во время запроса:
+                                 на время такой генерации фоновые потоки не
+                                 начинают новых полей, а она сама занимает
+                                 только ядра, не занятые фоновыми потоками,
+                                 так что всего потоков не больше N
+       WARM ROWS COLS DENSITY -> OK; пул создаётся и заполняется заранее
+       STATS                  -> по строке на пул:
+                                 POOL ROWS COLS DENSITY size=S/K hits=H misses=M generated=G failed=F
+                                 и строка END
+       QUIT (или конец ввода) -> фоновые потоки завершают текущие поля, процесс выходит
+     На ошибку отвечается строкой "ERR описание".
+
+     Если фоновая генерация для пула не нашла решаемого поля за MAX_ATTEMPTS
+     попыток, пул помечается застрявшим и не пополняется до следующего запроса,
+     которому удалось получить поле, — чтобы безнадёжные параметры не занимали ядра.
+   */
+#define SERVE_POOL_DEFAULT 8
+#define SERVE_MAX_POOLS 64
+#define SERVE_MAX_CELLS (1 << 20)   /* поля крупнее сервис не держит в пулах */
+
+/* PooledBoard — готовое решаемое поле и его стартовая клетка. */
+typedef struct {
+    Field* field;
+    int start_r, start_c;
+} PooledBoard;
+
+/* BoardPool — запас полей для одного набора параметров (кольцевой буфер). */
+typedef struct {
+    int rows, cols;
+    double percent;
+    int mines;               /* >= 0 — ровно столько мин вместо percent */
+    PooledBoard* boards;
+    int head, size;
+    int in_flight;           /* сколько полей для пула генерируется прямо сейчас */
+    bool stalled;            /* фоновая генерация не нашла поле — не пополнять */
+    long long hits, misses, generated, failed;
+} BoardPool;
+
+/* BoardServer — пулы, фоновые потоки и общий счётчик полей. */
+typedef struct {
+    BoardPool pools[SERVE_MAX_POOLS];
+    int npools;
+    int pool_cap;
+    int threads;
+    int busy;                /* сколько фоновых потоков сейчас генерируют поле */
+    int paused;              /* сколько GET сейчас генерируют поле сами (см. serve_get) */
+    uint64_t seed;
+    uint64_t next_board;     /* номер следующего поля: seed = derive_seed(seed, номер) */
+    bool stop;
+    mutex_handle lock;
+    cond_handle need_work;   /* в каком-то пуле освободилось место или пора выходить */
+} BoardServer;
+
+/* serve_find_pool — пул с такими параметрами; при create — создаёт новый (под lock). */
+static BoardPool* serve_find_pool(BoardServer* sv, int rows, int cols, double percent, int mines, bool create) {
+    for (int k = 0; k < sv->npools; ++k) {
+        BoardPool* p = &sv->pools[k];
+        if (p->rows == rows && p->cols == cols && p->mines == mines && (mines >= 0 || p->percent == percent))
+            return p;
+    }
+    if (!create || sv->npools == SERVE_MAX_POOLS) return NULL;
+    PooledBoard* boards = (PooledBoard*)calloc(sv->pool_cap, sizeof(PooledBoard));
+    if (!boards) return NULL;
+    BoardPool* p = &sv->pools[sv->npools++];
+    memset(p, 0, sizeof(*p));
+    p->rows = rows;
+    p->cols = cols;
+    p->percent = percent;
+    p->mines = mines;
+    p->boards = boards;
+    cond_broadcast(&sv->need_work);
+    return p;
+}
+
+/* serve_pick_pool — самый пустой пул, которому нужно поле, или NULL (под lock).
+   Пока GET генерирует поле сам, новых полей фоновые потоки не начинают. */
+static BoardPool* serve_pick_pool(BoardServer* sv) {
+    BoardPool* best = NULL;
+    if (sv->paused > 0) return NULL;
+    for (int k = 0; k < sv->npools; ++k) {
+        BoardPool* p = &sv->pools[k];
+        int have = p->size + p->in_flight;
+        if (p->stalled || have >= sv->pool_cap) continue;
+        if (!best || have < best->size + best->in_flight) best = p;
+    }
+    return best;
+}
+
+/* serve_generate — одно решаемое поле с параметрами пула; NULL, если не нашлось.
+   Параметры пула после создания не меняются, поэтому читаются без lock. */
+static Field* serve_generate(const BoardPool* p, uint64_t seed, int threads, int* out_r, int* out_c) {
+    Field* f = field_create(p->rows, p->cols);
+    if (!f) return NULL;
+    if (!generate_solvable_parallel(f, p->percent, p->mines, seed, threads, MAX_ATTEMPTS, out_r, out_c, NULL, NULL)) {
+        field_free(f);
+        return NULL;
+    }
+    return f;
+}
+
+/* serve_worker — фоновый поток: пополняет пулы, пока сервер не остановят. */
+static THREAD_PROC(serve_worker) {
+    BoardServer* sv = (BoardServer*)arg;
+    mutex_lock(&sv->lock);
+    for (;;) {
+        BoardPool* p = NULL;
+        while (!sv->stop && (p = serve_pick_pool(sv)) == NULL) cond_wait(&sv->need_work, &sv->lock);
+        if (sv->stop) break;
+        p->in_flight++;
+        sv->busy++;
+        uint64_t seed = derive_seed(sv->seed, sv->next_board++);
+        mutex_unlock(&sv->lock);
+
+        int r = 0, c = 0;
+        Field* f = serve_generate(p, seed, 1, &r, &c);
+
+        mutex_lock(&sv->lock);
+        p->in_flight--;
+        sv->busy--;
+        if (f) {
+            PooledBoard* b = &p->boards[(p->head + p->size) % sv->pool_cap];
+            b->field = f;
+            b->start_r = r;
+            b->start_c = c;
+            p->size++;
+            p->generated++;
+        }
+        else {
+            p->failed++;
+            p->stalled = true;
+        }
+    }
+    mutex_unlock(&sv->lock);
+    stats_flush();
+    THREAD_RETURN;
+}
+
+/* serve_print_density — плотность в том же виде, в каком её принимает GET. */
+static void serve_print_density(const BoardPool* p, FILE* out) {
+    if (p->mines >= 0) fprintf(out, "%dm", p->mines);
+    else fprintf(out, "%g", p->percent);
+}
+
+/* serve_get
+   - Ответ на GET: поле из пула или, если пул пуст, только что сгенерированное.
+   - На время такой генерации фоновые потоки приостанавливаются (paused): уже
+     начатые поля они доделывают, новых не берут, а генерация запроса получает
+     оставшиеся threads - busy ядер (хотя бы одно — вызывающий поток).
+*/
+static void serve_get(BoardServer* sv, int rows, int cols, double percent, int mines) {
+    double t0 = now_seconds();
+    PooledBoard b = { NULL, 0, 0 };
+    int threads = 1;
+    mutex_lock(&sv->lock);
+    BoardPool* p = serve_find_pool(sv, rows, cols, percent, mines, true);
+    if (p && p->size > 0) {
+        b = p->boards[p->head];
+        p->head = (p->head + 1) % sv->pool_cap;
+        p->size--;
+        p->hits++;
+        cond_signal(&sv->need_work); /* место освободилось — пусть пополнят */
+    }
+    else if (p) {
+        p->misses++;
+        sv->paused++;
+        if (sv->threads - sv->busy > threads) threads = sv->threads - sv->busy;
+    }
+    uint64_t seed = derive_seed(sv->seed, sv->next_board++);
+    mutex_unlock(&sv->lock);
+
+    if (!p) { printf("ERR слишком много разных пулов или нет памяти\n"); return; }
+    bool hit = b.field != NULL;
+    if (!hit) {
+        b.field = serve_generate(p, seed, threads, &b.start_r, &b.start_c);
+        mutex_lock(&sv->lock);
+        if (b.field) p->stalled = false;
+        if (--sv->paused == 0) cond_broadcast(&sv->need_work);
+        mutex_unlock(&sv->lock);
+        if (!b.field) { printf("ERR не удалось сгенерировать решаемое поле за %d попыток\n", MAX_ATTEMPTS); return; }
+    }
+    printf("OK %d %d %s %.0f\n", b.start_r, b.start_c, hit ? "HIT" : "MISS", (now_seconds() - t0) * 1e6);
+    save_field_to_stream(b.field, stdout);
+    field_free(b.field);
+}
+
+/* serve_stats — ответ на STATS. */
+static void serve_stats(BoardServer* sv) {
+    mutex_lock(&sv->lock);
+    for (int k = 0; k < sv->npools; ++k) {
+        const BoardPool* p = &sv->pools[k];
+        printf("POOL %d %d ", p->rows, p->cols);
+        serve_print_density(p, stdout);
+        printf(" size=%d/%d hits=%lld misses=%lld generated=%lld failed=%lld\n",
+            p->size, sv->pool_cap, p->hits, p->misses, p->generated, p->failed);
+    }
+    mutex_unlock(&sv->lock);
+    printf("END\n");
+}
+
+/* run_serve — разбор аргументов и цикл обработки запросов; возвращает код завершения. */
+int run_serve(int argc, char** argv) {
+    BoardServer* sv = (BoardServer*)calloc(1, sizeof(BoardServer));
+    if (!sv) { fprintf(stderr, "Недостаточно памяти\n"); return 1; }
+    sv->threads = cpu_count();
+    sv->pool_cap = SERVE_POOL_DEFAULT;
+    sv->seed = (uint64_t)time(NULL);
+    bool ok = true;
+    for (int a = 2; ok && a < argc; a += 2) {
+        long long v;
+        ok = a + 1 < argc && parse_long_arg(argv[a + 1], &v);
+        if (ok && strcmp(argv[a], "-j") == 0 && v >= 1 && v <= 1024) sv->threads = (int)v;
+        else if (ok && strcmp(argv[a], "--pool") == 0 && v >= 1 && v <= 100000) sv->pool_cap = (int)v;
+        else if (ok && strcmp(argv[a], "--seed") == 0) sv->seed = (uint64_t)v;
+        else ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Использование: %s --serve [-j N] [--pool K] [--seed S]\n"
+            "  Запросы в stdin: GET ROWS COLS DENSITY | WARM ROWS COLS DENSITY | STATS | QUIT\n", argv[0]);
+        free(sv);
+        return 2;
+    }
+
+    mutex_init(&sv->lock);
+    cond_init(&sv->need_work);
+    thread_handle* handles = (thread_handle*)malloc(sv->threads * sizeof(thread_handle));
+    int started = 0;
+    while (handles && started < sv->threads && thread_start(&handles[started], serve_worker, sv)) ++started;
+    if (started == 0) fprintf(stderr, "Фоновые потоки не запустились: поля будут генерироваться по запросу\n");
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin)) {
+        char cmd[16], dens[32], extra[2];
+        long long rows = 0, cols = 0;
+        int nf = sscanf(line, "%15s %lld %lld %31s %1s", cmd, &rows, &cols, dens, extra);
+        if (nf <= 0) continue; /* пустая строка */
+        if (strcmp(cmd, "QUIT") == 0 && nf == 1) break;
+        if (strcmp(cmd, "STATS") == 0 && nf == 1) serve_stats(sv);
+        else if ((strcmp(cmd, "GET") == 0 || strcmp(cmd, "WARM") == 0) && nf == 4) {
+            double percent;
+            int mines;
+            if (rows <= 0 || cols <= 0 || rows * cols > SERVE_MAX_CELLS ||
+                !parse_density_arg(dens, rows * cols, &percent, &mines))
+                printf("ERR неверные параметры поля (не больше %d клеток)\n", SERVE_MAX_CELLS);
+            else if (cmd[0] == 'G') serve_get(sv, (int)rows, (int)cols, percent, mines);
+            else {
+                mutex_lock(&sv->lock);
+                bool created = serve_find_pool(sv, (int)rows, (int)cols, percent, mines, true) != NULL;
+                mutex_unlock(&sv->lock);
+                printf(created ? "OK\n" : "ERR слишком много разных пулов или нет памяти\n");
+            }
+        }
+        else printf("ERR неизвестный запрос\n");
+        fflush(stdout);
+    }
+
+    mutex_lock(&sv->lock);
+    sv->stop = true;
+    cond_broadcast(&sv->need_work);
+    mutex_unlock(&sv->lock);
+    for (int t = 0; t < started; ++t) thread_join(handles[t]);
+    free(handles);
+
+#ifdef MS_STATS
+    {
+        SolverStats st = stats_take();
+        stats_print(stderr, &st);
+    }
+#endif
+    for (int k = 0; k < sv->npools; ++k) {
+        BoardPool* p = &sv->pools[k];
+        for (int j = 0; j < p->size; ++j) field_free(p->boards[(p->head + j) % sv->pool_cap].field);
+        free(p->boards);
+    }
+    cond_destroy(&sv->need_work);
+    mutex_destroy(&sv->lock);
+    free(sv);
+    return 0;
+}
+
 /* ===================================================================
-   Детерминистический солвер (локальные правила)
+   Потоковая генерация больших полей (--stream)
    =================================================================== */
 
    /*
-     Идея (простыми словами):
-       - Мы моделируем, как играет человек, применяя только очевидные локальные правила,
-         без угадывания и сложных дедукций.
-       - Правила те же, что в реальной игре:
-           * Если число в клетке n == (количество помеченных мин) + (количество закрытых соседних клеток),
-             то все эти закрытые клетки — мины.
-           * Если число в клетке n == (количество помеченных мин), то все остальные закрытые
-             соседние клетки безопасны и их можно открыть.
-       - Алгоритм стартует с одной стартовой клетки (как будто игрок кликнул на неё).
-         Мы будем пробовать разные стартовые клетки (в check_solvability).
-   */
+     minesweeper --stream ROWS COLS DENSITY SEED OUT
+       - генерирует поле ROWSxCOLS и пишет его прямо в OUT, не держа поле в памяти:
+         счётчик клетки зависит только от строки над ней, её строки и строки под ней,
+         поэтому достаточно скользящего окна из трёх строк мин (память ~ 6 * COLS байт
+         при любом ROWS);
+       - OUT с расширением .msb — двоичный формат, иначе текстовый; "-" — текст в stdout;
+       - мины выбирает тот же MineSampler, что и generate_by_probability, с Rng
+         попытки 0 для SEED: поле совпадает с первой попыткой обычной генерации
+         с тем же seed. Решаемость не проверяется — солверу нужно всё поле.
 
-   /* simulate_solver_from
-      - Пытаемся логически раскрыть всё поле, начиная со start_r,start_c.
-      - Возвращает true, если все безопасные клетки можно открыть, применяя только локальную логику.
-      - Вспомогательные массивы:
-          state[i]        : -1 = закрыта, >=0 = открыта и содержит число (f->count[i])
-          inferred_mine[i]: 0/1 — внутреннее помечение, что клетка точно мина (не игровой флаг)
-      - Использует очередь (BFS - (англ. breadth-first search, «поиск в ширину») — 
-      алгоритм обхода графа в ширину.) для раскрытия нулевых областей.
+     Число мин входит в заголовок, а известно только в конце, поэтому выборка
+     повторяется с сохранённого состояния Rng: первый проход лишь считает мины
+     (O(mines) случайных чисел), следующие пишут данные. Двоичному формату нужны
+     два прохода записи — плоскость мин, затем плоскость счётчиков.
    */
-bool simulate_solver_from(const Field* f, int start_r, int start_c) {
-    if (!f) return false;
-    int R = f->rows, C = f->cols, N = R * C;
 
-    /* state: -1 закрыта, 0..8 открыта */
-    int* state = (int*)malloc(N * sizeof(int));
-    if (!state) return false;
-    for (int i = 0; i < N; ++i) state[i] = -1;
+   /* StreamGen — скользящее окно из трёх строк мин поверх MineSampler. */
+typedef struct {
+    int64_t rows, cols;
+    double percent;
+    Rng rng0;             /* состояние Rng в начале выборки (для повторных проходов) */
+    Rng rng;
+    MineSampler sampler;
+    int64_t next_mine;    /* следующая ещё не разложенная по строкам мина (-1 — нет) */
+    int64_t next_row;     /* номер строки, которую заполнит stream_gen_fill */
+    unsigned char* win;   /* 3 строки мин по cols байт: выше, текущая, ниже */
+    unsigned char* zero;  /* нулевая строка за краем поля */
+    unsigned char* vsum;  /* рабочий буфер count_row_kernel, cols + 2 */
+    unsigned char* counts;/* счётчики текущей строки */
+} StreamGen;
 
-    /* inferred_mine: внутренние пометки о том, что клетка наверняка мина */
-    unsigned char* inferred_mine = (unsigned char*)calloc(N, sizeof(unsigned char));
-    if (!inferred_mine) { free(state); return false; }
+/* stream_gen_rewind — начинает выборку мин заново с сохранённого состояния Rng. */
+static void stream_gen_rewind(StreamGen* g) {
+    g->rng = g->rng0;
+    mine_sampler_init(&g->sampler, &g->rng, g->percent, g->rows * g->cols);
+    g->next_mine = mine_sampler_next(&g->sampler);
+    g->next_row = 0;
+}
 
-    /* сколько безопасных клеток должно быть открыто в конце */
-    int safe_total = 0;
-    for (int i = 0; i < N; ++i) if (!f->is_mine[i]) ++safe_total;
+static bool stream_gen_init(StreamGen* g, int64_t rows, int64_t cols, double percent, uint64_t seed) {
+    memset(g, 0, sizeof(*g));
+    g->rows = rows;
+    g->cols = cols;
+    g->percent = percent;
+    rng_seed_attempt(&g->rng0, seed, 0);
+    size_t C = (size_t)cols;
+    g->win = (unsigned char*)malloc(3 * C);
+    g->zero = (unsigned char*)calloc(C, 1);
+    g->vsum = (unsigned char*)malloc(C + 2);
+    g->counts = (unsigned char*)malloc(C);
+    if (!g->win || !g->zero || !g->vsum || !g->counts) {
+        free(g->win); free(g->zero); free(g->vsum); free(g->counts);
+        return false;
+    }
+    stream_gen_rewind(g);
+    return true;
+}
 
-    int start_idx = IDX(f, start_r, start_c);
-    if (f->is_mine[start_idx]) { free(state); free(inferred_mine); return false; }
+static void stream_gen_free(StreamGen* g) {
+    free(g->win);
+    free(g->zero);
+    free(g->vsum);
+    free(g->counts);
+}
 
-    /* очередь для BFS раскрытия нулей */
-    int* queue = (int*)malloc(N * sizeof(int));
-    if (!queue) { free(state); free(inferred_mine); return false; }
-    int qh = 0, qt = 0;
+/* stream_gen_fill — заполняет row (cols байт 0/1) минами следующей строки. */
+static void stream_gen_fill(StreamGen* g, unsigned char* row) {
+    int64_t base = g->next_row * g->cols, end = base + g->cols;
+    memset(row, 0, (size_t)g->cols);
+    while (g->next_mine >= 0 && g->next_mine < end) {
+        row[g->next_mine - base] = 1;
+        g->next_mine = mine_sampler_next(&g->sampler);
+    }
+    g->next_row++;
+}
 
-    /* открываем стартовую клетку */
-    state[start_idx] = f->count[start_idx];
-    if (f->count[start_idx] == 0) {
-        /* если ноль — расширяем нулевую область */
-        queue[qt++] = start_idx;
-        while (qh < qt) {
-            int cur = queue[qh++];
-            int rr = cur / C, cc = cur % C;
-            for (int dr = -1; dr <= 1; ++dr)
-                for (int dc = -1; dc <= 1; ++dc) {
-                    if (dr == 0 && dc == 0) continue;
-                    int r2 = rr + dr, c2 = cc + dc;
-                    if (r2 >= 0 && r2 < R && c2 >= 0 && c2 < C) {
-                        int p2 = IDX(f, r2, c2);
-                        if (f->is_mine[p2]) continue;
-                        if (state[p2] == -1) {
-                            state[p2] = f->count[p2];
-                            if (f->count[p2] == 0) queue[qt++] = p2;
-                        }
-                    }
+/* stream_gen_count_mines — проход, который только считает мины всего поля. */
+static int64_t stream_gen_count_mines(StreamGen* g) {
+    int64_t mines = 0;
+    stream_gen_rewind(g);
+    for (; g->next_mine >= 0; g->next_mine = mine_sampler_next(&g->sampler)) ++mines;
+    stream_gen_rewind(g);
+    return mines;
+}
+
+/* stream_gen_row
+   - Выдаёт очередную строку r = 0, 1, ...: *mines — её мины, *counts — счётчики.
+   - Окно сдвигается по кругу: строка ниже текущей генерируется заранее.
+*/
+static void stream_gen_row(StreamGen* g, int64_t r, const unsigned char** mines, const unsigned char** counts) {
+    size_t C = (size_t)g->cols;
+    unsigned char* up = g->win + (size_t)((r + 2) % 3) * C;
+    unsigned char* mid = g->win + (size_t)(r % 3) * C;
+    unsigned char* down = g->win + (size_t)((r + 1) % 3) * C;
+    if (r == 0) stream_gen_fill(g, mid);
+    if (r + 1 < g->rows) stream_gen_fill(g, down);
+    count_row_kernel(r > 0 ? up : g->zero, mid, r + 1 < g->rows ? down : g->zero,
+        g->vsum, g->counts, (int)C);
+    *mines = mid;
+    *counts = g->counts;
+}
+
+/* stream_write_text — текстовый формат (см. save_field_to_stream), строка за строкой. */
+static bool stream_write_text(StreamGen* g, FILE* out) {
+    size_t C = (size_t)g->cols;
+    char* line = (char*)malloc(C + 1);
+    if (!line) return false;
+    int64_t mines = stream_gen_count_mines(g);
+    bool ok = fprintf(out, "%" PRId64 " %" PRId64 " %" PRId64 "\n", g->rows, g->cols, mines) > 0;
+    for (int64_t r = 0; ok && r < g->rows; ++r) {
+        const unsigned char *m, *cnt;
+        stream_gen_row(g, r, &m, &cnt);
+        for (size_t c = 0; c < C; ++c) line[c] = m[c] ? 'M' : (char)('0' + cnt[c]);
+        line[C] = '\n';
+        ok = fwrite(line, 1, C + 1, out) == C + 1;
+    }
+    free(line);
+    return ok;
+}
+
+/* stream_write_binary
+   - Двоичный формат (см. save_field_binary) со счётчиками: заголовок, затем проход
+     по плоскости мин и проход по плоскости счётчиков. Биты и тетрады переносятся
+     через границы строк, как в упакованном Field.
+*/
+static bool stream_write_binary(StreamGen* g, FILE* out, uint64_t seed) {
+    int64_t mines = stream_gen_count_mines(g);
+    unsigned char hdr[BOARD_BIN_HEADER] = { 0 };
+    memcpy(hdr, BOARD_BIN_MAGIC, 4);
+    put_le(hdr + 4, BOARD_BIN_VERSION, 2);
+    put_le(hdr + 6, BOARD_BIN_HAS_COUNTS, 2);
+    put_le(hdr + 8, (uint64_t)g->rows, 4);
+    put_le(hdr + 12, (uint64_t)g->cols, 4);
+    put_le(hdr + 16, (uint64_t)mines, 4);
+    put_le(hdr + 24, seed, 8);
+    bool ok = fwrite(hdr, 1, sizeof(hdr), out) == sizeof(hdr);
+
+    unsigned char buf[4096];
+    size_t k = 0;
+    unsigned acc = 0;
+    int nbits = 0;
+    for (int pass = 0; ok && pass < 2; ++pass) {
+        stream_gen_rewind(g);
+        int shift = pass == 0 ? 1 : 4; /* бит на клетку — мины, тетрада — счётчики */
+        for (int64_t r = 0; ok && r < g->rows; ++r) {
+            const unsigned char *m, *cnt;
+            if (pass == 0) { stream_gen_fill(g, g->win); m = g->win; }
+            else stream_gen_row(g, r, &m, &cnt);
+            const unsigned char* v = pass == 0 ? m : cnt;
+            for (int64_t c = 0; c < g->cols; ++c) {
+                acc |= (unsigned)v[c] << nbits;
+                nbits += shift;
+                if (nbits == 8) {
+                    buf[k++] = (unsigned char)acc;
+                    acc = 0;
+                    nbits = 0;
+                    if (k == sizeof(buf)) { ok = ok && fwrite(buf, 1, k, out) == k; k = 0; }
                 }
+            }
         }
+        /* плоскость дополняется нулями до целого байта */
+        if (nbits > 0) { buf[k++] = (unsigned char)acc; acc = 0; nbits = 0; }
+        if (ok && k > 0) ok = fwrite(buf, 1, k, out) == k;
+        k = 0;
     }
+    return ok;
+}
 
-    /* основной итеративный цикл применения локальных правил */
-    bool changed = true;
-    while (changed) {
-        changed = false;
+/* run_stream
+   - Разбирает аргументы потокового режима и пишет поле; возвращает код завершения.
+   - Поле ограничено 2^32 - 1 клетками (32-битное число мин в двоичном заголовке).
+*/
+int run_stream(int argc, char** argv) {
+    long long rows, cols, seed;
+    double percent;
+    if (argc != 7 || !parse_long_arg(argv[2], &rows) || !parse_long_arg(argv[3], &cols) ||
+        !parse_double_arg(argv[4], &percent) || !parse_long_arg(argv[5], &seed) ||
+        rows <= 0 || cols <= 0 || rows > INT32_MAX || cols > INT32_MAX ||
+        rows * cols > (long long)UINT32_MAX || !(percent >= 0 && percent <= 100)) {
+        fprintf(stderr, "Использование: %s --stream ROWS COLS DENSITY SEED OUT\n"
+            "  OUT — файл (.msb — двоичный формат, иначе текст) или \"-\" для stdout.\n", argv[0]);
+        return 2;
+    }
+    const char* fname = argv[6];
+    size_t len = strlen(fname);
+    bool binary = len > 4 && strcmp(fname + len - 4, ".msb") == 0;
+    bool to_stdout = strcmp(fname, "-") == 0;
 
-        /* для каждой открытой клетки считаем соседей и пробуем применить правила */
-        for (int r = 0; r < R; ++r) {
-            for (int c = 0; c < C; ++c) {
-                int p = IDX(f, r, c);
-                if (state[p] < 0) continue; /* если закрыта — пропускаем */
-
-                int n = state[p]; /* число на этой клетке */
-                int inferred_neighbors = 0; /* уже помеченные внутренне как мины */
-                int unknown_neighbors = 0;  /* закрытые и непомеченные соседи */
-                int unknown_list[8];
-                int unknown_k = 0;
-
-                for (int dr = -1; dr <= 1; ++dr)
-                    for (int dc = -1; dc <= 1; ++dc) {
-                        if (dr == 0 && dc == 0) continue;
-                        int rr = r + dr, cc = c + dc;
-                        if (rr >= 0 && rr < R && cc >= 0 && cc < C) {
-                            int p2 = IDX(f, rr, cc);
-                            if (inferred_mine[p2]) inferred_neighbors++;
-                            else if (state[p2] == -1) {
-                                unknown_list[unknown_k++] = p2;
-                                unknown_neighbors++;
-                            }
-                        }
-                    }
+    StreamGen g;
+    if (!stream_gen_init(&g, rows, cols, percent, (uint64_t)seed)) {
+        fprintf(stderr, "Недостаточно памяти для строки из %lld клеток\n", cols);
+        return 1;
+    }
+    FILE* out = to_stdout ? stdout : fopen(fname, binary ? "wb" : "w");
+    if (!out) {
+        fprintf(stderr, "Не удалось открыть %s\n", fname);
+        stream_gen_free(&g);
+        return 1;
+    }
+    double t0 = now_seconds();
+    bool ok = binary ? stream_write_binary(&g, out, (uint64_t)seed) : stream_write_text(&g, out);
+    if (to_stdout) { if (fflush(out) != 0) ok = false; }
+    else if (fclose(out) != 0) ok = false;
+    stream_gen_free(&g);
 
-                /* Правило A: если число == known + unknown -> все unknown — мины */
-                if (unknown_neighbors > 0 && n == inferred_neighbors + unknown_neighbors) {
-                    for (int k = 0; k < unknown_k; ++k) {
-                        int p2 = unknown_list[k];
-                        if (!inferred_mine[p2]) {
-                            inferred_mine[p2] = 1;
-                            changed = true;
-                        }
-                    }
-                }
+    if (!ok) { fprintf(stderr, "Ошибка при записи в %s\n", fname); return 1; }
+    fprintf(stderr, "Записано поле %lldx%lld за %.2f с\n", rows, cols, now_seconds() - t0);
+    return 0;
+}
 
-                /* Правило B: если число == known -> все unknown безопасны -> открываем их */
-                if (unknown_neighbors > 0 && n == inferred_neighbors) {
-                    for (int k = 0; k < unknown_k; ++k) {
-                        int p2 = unknown_list[k];
-                        if (state[p2] == -1 && !inferred_mine[p2]) {
-                            state[p2] = f->count[p2];
-                            changed = true;
-                            /* если новый открытый — ноль, добавляем в очередь для flood-fill */
-                            if (f->count[p2] == 0) queue[qt++] = p2;
-                        }
-                    }
-                }
+/* ===================================================================
+   Решение сохранённого поля (--solve)
+   =================================================================== */
+
+   /*
+     minesweeper --solve FILE ROW COL [-j N]
+       - Загружает поле (текст или .msb) и запускает детерминистический солвер из
+         клетки (ROW, COL); при N > 1 — параллельно, полосами строк (solver_bands_run).
+         По умолчанию N = 1: выигрыш полос зависит от машины, его показывает --bench.
+       - Печатает, сколько безопасных клеток открыто и за какое время;
+         код завершения 0 — поле решено, 1 — нет или ошибка, 2 — неверные аргументы.
+   */
+int run_solve(int argc, char** argv) {
+    long long row, col, threads = 1;
+    if ((argc != 5 && argc != 7) || !parse_long_arg(argv[3], &row) || !parse_long_arg(argv[4], &col) ||
+        (argc == 7 && (strcmp(argv[5], "-j") != 0 || !parse_long_arg(argv[6], &threads) ||
+            threads < 1 || threads > 1024))) {
+        fprintf(stderr, "Использование: %s --solve FILE ROW COL [-j N]\n", argv[0]);
+        return 2;
+    }
+
+    FieldView v;
+    Field* loaded = NULL;
+    const Field* f;
+    bool binary = is_binary_board_file(argv[2]);
+    if (binary) {
+        if (!field_view_open(&v, argv[2])) { fprintf(stderr, "Не удалось прочитать %s\n", argv[2]); return 1; }
+        f = &v.field;
+    }
+    else {
+        loaded = load_field_from_file(argv[2]);
+        if (!loaded) { fprintf(stderr, "Не удалось прочитать %s\n", argv[2]); return 1; }
+        f = loaded;
+    }
+
+    int rc = 1;
+    if (row < 0 || row >= f->rows || col < 0 || col >= f->cols) {
+        fprintf(stderr, "Клетка (%lld, %lld) вне поля %dx%d\n", row, col, f->rows, f->cols);
+        rc = 2;
+    }
+    else if (field_mine(f, IDX(f, (int)row, (int)col))) {
+        printf("Стартовая клетка — мина.\n");
+    }
+    else {
+        SolverCtx* s = solver_ctx_create(f->rows, f->cols);
+        if (s) {
+            solver_ctx_bind(s, f);
+            double t0 = now_seconds();
+            bool solved = solver_bands_run(s, f, IDX(f, (int)row, (int)col), (int)threads);
+            double t = now_seconds() - t0;
+            printf("%s: открыто %d из %d безопасных клеток за %.3f с\n",
+                solved ? "Решено" : "Не решено", s->opened, s->safe_total, t);
+            rc = solved ? 0 : 1;
+        }
+        else fprintf(stderr, "Недостаточно памяти для поля %dx%d\n", f->rows, f->cols);
+        solver_ctx_free(s);
+    }
+#ifdef MS_STATS
+    {
+        SolverStats st = stats_take();
+        stats_print(stderr, &st);
+    }
+#endif
+    if (binary) field_view_close(&v);
+    field_free(loaded);
+    return rc;
+}
+
+/* ===================================================================
+   Замеры производительности (--bench)
+   =================================================================== */
+
+   /*
+     minesweeper --bench [-j N] [FILE]
+       Прогоняет горячие пути на сетке размеров 8x8 .. 2000x2000 и плотностей 5..30%
+       с фиксированными seed'ами и пишет результаты в JSON (в FILE или в stdout),
+       чтобы сравнивать сборки между собой. Ход замеров печатается в stderr.
+
+     Для каждой пары (размер, плотность):
+       gen_ns_per_cell     — generate_by_probability (вместе с compute_counts)
+       counts_ns_per_cell  — compute_counts отдельно
+       solver_ns_per_cell  — simulate_solver_from из одной стартовой клетки
+       solver_work_per_cell— сколько клеток солвер взял из очереди на клетку поля
+                             (аналог "раундов" полного прохода для worklist-солвера)
+       bands_ns_per_cell   — тот же запуск через solver_bands_run на N потоках
+                             (по умолчанию — на всех ядрах); только для полей от
+                             PAR_SOLVER_MIN_CELLS клеток и N > 1, иначе null.
+                             Сравнение с solver_ns_per_cell показывает, стоит ли
+                             на этой машине включать полосы в --solve -j N
+       solvable_rate, attempts_per_solvable, check_ms — по серии полей
+                             generate_by_probability + check_solvability (не дольше
+                             BENCH_SOLVE_TIME); для полей больше BENCH_SOLVE_MAX_CELLS
+                             не измеряются (null).
+   */
+#define BENCH_SEED 20240601ULL
+#define BENCH_MIN_TIME 0.05            /* минимальное время одного замера, с */
+#define BENCH_SOLVE_BOARDS 40          /* наибольшее число полей в серии проверки решаемости */
+#define BENCH_SOLVE_TIME 1.0           /* серия прерывается после этого времени, с */
+#define BENCH_SOLVE_MAX_CELLS 250000   /* крупнее — check_solvability не меряем */
+
+static const char* simd_name(void) {
+#if defined(MS_SIMD_AVX2)
+    return "avx2";
+#elif defined(MS_SIMD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/* BenchResult — результаты для одной пары (размер, плотность). */
+typedef struct {
+    double gen_ns, counts_ns, solver_ns, solver_work, bands_ns;
+    int solve_boards, solvable;
+    double check_ms;
+} BenchResult;
+
+/* bench_one — замеры для поля rows x cols с плотностью percent. */
+static bool bench_one(int rows, int cols, double percent, uint64_t seed, int threads, BenchResult* res) {
+    Field* f = field_create(rows, cols);
+    if (!f) return false;
+    double cells = (double)rows * cols;
+    Rng rng;
+    rng_seed(&rng, seed);
+
+    /* генерация: повторяем, пока не наберётся BENCH_MIN_TIME */
+    int reps = 0;
+    double t0 = now_seconds(), t;
+    do { generate_by_probability(f, percent, &rng); ++reps; } while ((t = now_seconds() - t0) < BENCH_MIN_TIME);
+    res->gen_ns = t * 1e9 / (reps * cells);
+
+    reps = 0;
+    t0 = now_seconds();
+    do { compute_counts(f); ++reps; } while ((t = now_seconds() - t0) < BENCH_MIN_TIME);
+    res->counts_ns = t * 1e9 / (reps * cells);
+
+    /* солвер из самой большой нулевой области последнего поля
+       (или из первой безопасной клетки, если нулей нет) */
+    SolverCtx* ctx = solver_ctx_create(rows, cols);
+    if (!ctx) { field_free(f); return false; }
+    int start = 0;
+    solver_ctx_bind(ctx, f);
+    int nz = label_zero_regions(ctx);
+    if (nz > 0) {
+        qsort(ctx->zones, nz, sizeof(StartClass), start_class_cmp);
+        start = ctx->zones[0].start;
+    }
+    if (nz <= 0) while (start < f->rows * f->cols && field_mine(f, start)) ++start;
+    res->solver_ns = res->solver_work = res->bands_ns = 0;
+    if (start < f->rows * f->cols) {
+        long long work = 0;
+        reps = 0;
+        t0 = now_seconds();
+        do {
+            solver_ctx_run(ctx, f, start);
+            work += ctx->processed;
+            ++reps;
+        } while ((t = now_seconds() - t0) < BENCH_MIN_TIME);
+        if (reps > 0) {
+            res->solver_ns = t * 1e9 / (reps * cells);
+            res->solver_work = (double)work / (reps * cells);
+        }
+    }
+    if (start < f->rows * f->cols && cells >= PAR_SOLVER_MIN_CELLS && threads > 1) {
+        reps = 0;
+        t0 = now_seconds();
+        do { solver_bands_run(ctx, f, start, threads); ++reps; } while ((t = now_seconds() - t0) < BENCH_MIN_TIME);
+        res->bands_ns = t * 1e9 / (reps * cells);
+    }
+
+    /* серия полей: доля решаемых и цена check_solvability */
+    res->solve_boards = res->solvable = 0;
+    res->check_ms = 0;
+    if (cells <= BENCH_SOLVE_MAX_CELLS) {
+        t0 = now_seconds();
+        for (int b = 0; b < BENCH_SOLVE_BOARDS && now_seconds() - t0 < BENCH_SOLVE_TIME; ++b) {
+            generate_by_probability(f, percent, &rng);
+            if (check_solvability_ctx(f, ctx, NULL, NULL)) res->solvable++;
+            res->solve_boards++;
+        }
+        res->check_ms = (now_seconds() - t0) * 1e3 / res->solve_boards;
+    }
+
+    solver_ctx_free(ctx);
+    field_free(f);
+    return true;
+}
+
+/* run_bench — полный прогон сетки замеров; возвращает код завершения. */
+int run_bench(int argc, char** argv) {
+    static const int sizes[][2] = {
+        { 8, 8 }, { 16, 16 }, { 16, 30 }, { 64, 64 }, { 200, 200 }, { 500, 500 }, { 1000, 1000 }, { 2000, 2000 }
+    };
+    static const double densities[] = { 5, 10, 15, 20, 25, 30 };
+    int nsizes = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    int ndens = (int)(sizeof(densities) / sizeof(densities[0]));
+
+    long long threads = cpu_count();
+    const char* path = NULL;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && parse_long_arg(argv[i + 1], &threads) &&
+            threads >= 1 && threads <= 1024) ++i;
+        else if (!path && argv[i][0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "Использование: %s --bench [-j N] [FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    FILE* out = stdout;
+    if (path) {
+        out = fopen(path, "w");
+        if (!out) { fprintf(stderr, "Не удалось открыть %s\n", path); return 1; }
+    }
+
+    fprintf(out, "{\n  \"seed\": %" PRIu64 ",\n  \"simd\": \"%s\",\n  \"bands_threads\": %lld,\n  \"results\": [\n",
+        (uint64_t)BENCH_SEED, simd_name(), threads);
+    int k = 0;
+    for (int si = 0; si < nsizes; ++si) {
+        for (int di = 0; di < ndens; ++di, ++k) {
+            int rows = sizes[si][0], cols = sizes[si][1];
+            BenchResult r;
+            fprintf(stderr, "%dx%d, %g%%...\n", rows, cols, densities[di]);
+            if (!bench_one(rows, cols, densities[di], derive_seed(BENCH_SEED, (uint64_t)k), (int)threads, &r)) {
+                fprintf(stderr, "Ошибка выделения памяти для %dx%d\n", rows, cols);
+                if (out != stdout) fclose(out);
+                return 1;
+            }
+
+            fprintf(out, "    {\"rows\": %d, \"cols\": %d, \"density\": %g, "
+                "\"gen_ns_per_cell\": %.3f, \"counts_ns_per_cell\": %.3f, "
+                "\"solver_ns_per_cell\": %.3f, \"solver_work_per_cell\": %.3f, ",
+                rows, cols, densities[di], r.gen_ns, r.counts_ns, r.solver_ns, r.solver_work);
+            if (r.bands_ns > 0) fprintf(out, "\"bands_ns_per_cell\": %.3f, ", r.bands_ns);
+            else fprintf(out, "\"bands_ns_per_cell\": null, ");
+            if (r.solve_boards > 0) {
+                fprintf(out, "\"solvable_rate\": %.4f, ", (double)r.solvable / r.solve_boards);
+                if (r.solvable > 0) fprintf(out, "\"attempts_per_solvable\": %.2f, ", (double)r.solve_boards / r.solvable);
+                else fprintf(out, "\"attempts_per_solvable\": null, ");
+                fprintf(out, "\"check_ms\": %.4f}", r.check_ms);
             }
+            else fprintf(out, "\"solvable_rate\": null, \"attempts_per_solvable\": null, \"check_ms\": null}");
+            fprintf(out, "%s\n", (si == nsizes - 1 && di == ndens - 1) ? "" : ",");
         }
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+/* ===================================================================
+   Самопроверка (--selftest)
+   =================================================================== */
+
+   /*
+     minesweeper --selftest [SEED]
+       - сверяет быстрые реализации с простыми эталонными на случайных полях
+         (seed по умолчанию фиксирован, так что прогон воспроизводим);
+       - печатает итог каждой проверки, код завершения 0 — расхождений нет.
+
+     Проверки:
+       - солвер: simulate_solver_from и solver_ctx_run (только правила A и B)
+         против эталона — исходного солвера с полными проходами по полю
+         (selftest_ref_solver) — из каждой безопасной стартовой клетки, на полях
+         1xN, Nx1, стандартных размеров (FIELD_PRESETS) и случайных;
+       - счётчики: compute_counts (векторное ядро count_row_kernel того пути,
+         с которым собрана программа — AVX2, SSE2 или скалярный, а для
+         стандартных размеров — compute_counts_RxC) против наивного тройного
+         цикла, на обычных и компактных полях, включая нечётные ширины;
+         заодно validate_field_ex должна принять верное поле и найти
+         испорченный счётчик;
+       - полосы: solver_bands_run на 2..4 потоках против solver_ctx_run (с правилом C
+         и без) на полях в несколько PAR_MIN_BAND_ROWS строк — те же открытые клетки.
+   */
+#define SELFTEST_SOLVER_BOARDS 400
+#define SELFTEST_COUNTS_BOARDS 400
+#define SELFTEST_BANDS_BOARDS 24
+#define SELFTEST_BANDS_STARTS 8
+
+/* selftest_ref_solver
+   - Эталон: исходный simulate_solver_from — пока что-то меняется, полный проход
+     по всем открытым клеткам с правилами A и B, нулевые области — BFS.
+   - Возвращает число открытых безопасных клеток (-1 — старт на мине или нет памяти).
+*/
+static int selftest_ref_solver(const Field* f, int start_idx) {
+    int R = f->rows, C = f->cols, N = R * C;
+    if (field_mine(f, start_idx)) return -1;
+    int* state = (int*)malloc(N * sizeof(int));          /* -1 закрыта, 0..8 открыта */
+    unsigned char* inferred_mine = (unsigned char*)calloc(N, sizeof(unsigned char));
+    int* queue = (int*)malloc(N * sizeof(int));          /* нули для раскрытия */
+    if (!state || !inferred_mine || !queue) {
+        free(state); free(inferred_mine); free(queue);
+        return -1;
+    }
+    for (int i = 0; i < N; ++i) state[i] = -1;
+    int qh = 0, qt = 0;
 
-        /* если очередь пополнилась нулями — расширяем их (BFS) */
+    state[start_idx] = field_count(f, start_idx);
+    if (state[start_idx] == 0) queue[qt++] = start_idx;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        /* раскрытие нулей */
         while (qh < qt) {
             int cur = queue[qh++];
-            int rr = cur / C, cc = cur % C;
+            int r = cur / C, c = cur % C;
             for (int dr = -1; dr <= 1; ++dr)
                 for (int dc = -1; dc <= 1; ++dc) {
-                    if (dr == 0 && dc == 0) continue;
-                    int r2 = rr + dr, c2 = cc + dc;
-                    if (r2 >= 0 && r2 < R && c2 >= 0 && c2 < C) {
-                        int p2 = IDX(f, r2, c2);
-                        if (f->is_mine[p2]) continue;
-                        if (state[p2] == -1 && !inferred_mine[p2]) {
-                            state[p2] = f->count[p2];
-                            if (f->count[p2] == 0) queue[qt++] = p2;
-                            changed = true; /* открытие изменило состояние */
-                        }
-                    }
+                    int rr = r + dr, cc = c + dc;
+                    if ((dr == 0 && dc == 0) || rr < 0 || rr >= R || cc < 0 || cc >= C) continue;
+                    int p2 = IDX(f, rr, cc);
+                    if (field_mine(f, p2) || state[p2] != -1 || inferred_mine[p2]) continue;
+                    state[p2] = field_count(f, p2);
+                    if (state[p2] == 0) queue[qt++] = p2;
+                    changed = true;
                 }
         }
-
-        /* после обработки очереди снова пойдёт полный проход — цикл завершится, когда
-           ни одно правило не сможет ничего нового пометить/открыть */
+        /* полный проход правил A и B */
+        for (int p = 0; p < N; ++p) {
+            if (state[p] < 0) continue;
+            int r = p / C, c = p % C;
+            int inferred = 0, unknown[8], nu = 0;
+            for (int dr = -1; dr <= 1; ++dr)
+                for (int dc = -1; dc <= 1; ++dc) {
+                    int rr = r + dr, cc = c + dc;
+                    if ((dr == 0 && dc == 0) || rr < 0 || rr >= R || cc < 0 || cc >= C) continue;
+                    int p2 = IDX(f, rr, cc);
+                    if (inferred_mine[p2]) ++inferred;
+                    else if (state[p2] == -1) unknown[nu++] = p2;
+                }
+            if (nu == 0) continue;
+            if (state[p] == inferred + nu) {          /* Правило A */
+                for (int k = 0; k < nu; ++k) inferred_mine[unknown[k]] = 1;
+                changed = true;
+            }
+            else if (state[p] == inferred) {          /* Правило B */
+                for (int k = 0; k < nu; ++k) {
+                    state[unknown[k]] = field_count(f, unknown[k]);
+                    if (state[unknown[k]] == 0) queue[qt++] = unknown[k];
+                }
+                changed = true;
+            }
+        }
     }
 
-    /* Считаем открытые безопасные клетки */
     int opened = 0;
-    for (int i = 0; i < N; ++i) if (!f->is_mine[i] && state[i] >= 0) ++opened;
-
-    free(queue);
-    free(inferred_mine);
+    for (int i = 0; i < N; ++i) if (state[i] >= 0) ++opened;
     free(state);
+    free(inferred_mine);
+    free(queue);
+    return opened;
+}
 
-    /* Возвращаем true только если открыты все безопасные клетки */
-    return opened == safe_total;
+/* selftest_shape — размер k-го поля проверки: по очереди 1xN, Nx1, стандартный, случайный. */
+static void selftest_shape(Rng* g, int k, int* rows, int* cols) {
+    static const int presets[][2] = {
+#define SELFTEST_PRESET(PR, PC) { PR, PC },
+        FIELD_PRESETS(SELFTEST_PRESET)
+#undef SELFTEST_PRESET
+    };
+    int np = (int)(sizeof(presets) / sizeof(presets[0]));
+    switch (k % 4) {
+    case 0: *rows = 1; *cols = 1 + (int)rng_below(g, 40); break;
+    case 1: *rows = 1 + (int)rng_below(g, 40); *cols = 1; break;
+    case 2: *rows = presets[(k / 4) % np][0]; *cols = presets[(k / 4) % np][1]; break;
+    default: *rows = 1 + (int)rng_below(g, 24); *cols = 1 + (int)rng_below(g, 24); break;
+    }
 }
 
-/*
-  check_solvability
-  - Перебирает все неминные клетки и вызывает simulate_solver_from для каждой.
-  - При первом успехе возвращает true.
-  - Если ни одна стартовая клетка не дала полного решения, возвращает false..
-*/
-bool check_solvability(const Field* f, int* out_r, int* out_c) {
-    if (!f) return false;
-    int R = f->rows, C = f->cols;
-    for (int r = 0; r < R; ++r) {
-        for (int c = 0; c < C; ++c) {
-            int idx = IDX(f, r, c);
-            if (f->is_mine[idx]) continue;
-            if (simulate_solver_from(f, r, c)) {
-                if (out_r) *out_r = r;
-                if (out_c) *out_c = c;
-                return true;
+/* selftest_solver — сверка солвера с эталоном (см. выше); возвращает число расхождений. */
+static long selftest_solver(Rng* g) {
+    bool pair_rules = solver_pair_rules_default;
+    solver_pair_rules_default = false; /* эталон знает только правила A и B */
+    long starts = 0, bad = 0;
+    for (int k = 0; k < SELFTEST_SOLVER_BOARDS; ++k) {
+        int rows, cols;
+        selftest_shape(g, k, &rows, &cols);
+        Field* f = field_create(rows, cols);
+        SolverCtx* s = f ? solver_ctx_create(rows, cols) : NULL;
+        if (!s) { field_free(f); ++bad; continue; }
+        generate_by_probability(f, (double)rng_below(g, 36), g);
+        solver_ctx_bind(s, f);
+        for (int i = 0; i < rows * cols; ++i) {
+            if (field_mine(f, i)) continue;
+            int ref = selftest_ref_solver(f, i);
+            bool ref_solved = ref == s->safe_total;
+            bool run = solver_ctx_run(s, f, i);
+            bool sim = simulate_solver_from(f, i / cols, i % cols);
+            ++starts;
+            if (ref < 0 || run != ref_solved || sim != ref_solved || s->opened != ref) {
+                if (bad < 5)
+                    fprintf(stderr, "  солвер: поле %dx%d, старт (%d, %d): эталон %d открытых, "
+                        "solver_ctx_run %d, simulate_solver_from %d\n",
+                        rows, cols, i / cols, i % cols, ref, s->opened, (int)sim);
+                ++bad;
             }
         }
+        solver_ctx_free(s);
+        field_free(f);
     }
-    return false;
+    solver_pair_rules_default = pair_rules;
+    printf("солвер (правила A и B) против эталона: полей %d, стартов %ld, расхождений %ld\n",
+        SELFTEST_SOLVER_BOARDS, starts, bad);
+    return bad;
+}
+
+/* selftest_ref_count — эталон: число мин среди соседей клетки (r, c) тройным циклом. */
+static int selftest_ref_count(const Field* f, int r, int c) {
+    int n = 0;
+    for (int dr = -1; dr <= 1; ++dr)
+        for (int dc = -1; dc <= 1; ++dc) {
+            int rr = r + dr, cc = c + dc;
+            if ((dr == 0 && dc == 0) || rr < 0 || rr >= f->rows || cc < 0 || cc >= f->cols) continue;
+            n += field_mine(f, IDX(f, rr, cc));
+        }
+    return n;
+}
+
+/* selftest_counts — сверка счётчиков и валидатора (см. выше); возвращает число расхождений. */
+static long selftest_counts(Rng* g) {
+    long cells = 0, bad = 0;
+    for (int k = 0; k < SELFTEST_COUNTS_BOARDS; ++k) {
+        int rows, cols;
+        if (k % 5 == 4) {             /* нечётная ширина: хвосты после 16/32 клеток */
+            rows = 1 + (int)rng_below(g, 12);
+            cols = 1 + 2 * (int)rng_below(g, 40);
+        }
+        else selftest_shape(g, k, &rows, &cols);
+        bool packed = (k / 5) % 2 == 1;
+        Field* f = field_create_ex(rows, cols, packed);
+        if (!f) { ++bad; continue; }
+        int n = rows * cols, percent = (int)rng_below(g, 101);
+        for (int i = 0; i < n; ++i) {
+            /* мусор в счётчиках: compute_counts должна перезаписать всё */
+            field_set_count(f, i, (int)rng_below(g, 16));
+            if ((int)rng_below(g, 100) < percent) { field_set_mine(f, i, 1); ++f->mines; }
+        }
+        compute_counts(f);
+        int safe = -1, mism = 0;
+        for (int i = 0; i < n; ++i) {
+            int want = field_mine(f, i) ? 0 : selftest_ref_count(f, i / cols, i % cols);
+            if (!field_mine(f, i) && safe < 0) safe = i;
+            if (field_count(f, i) != want) {
+                if (bad + mism < 5)
+                    fprintf(stderr, "  счётчики: поле %dx%d%s, клетка (%d, %d): %d вместо %d\n",
+                        rows, cols, packed ? " (компактное)" : "", i / cols, i % cols,
+                        field_count(f, i), want);
+                ++mism;
+            }
+        }
+        cells += n;
+        bad += mism;
+        if (mism == 0 && !validate_field_ex(f, false)) {
+            fprintf(stderr, "  валидатор: поле %dx%d отвергнуто\n", rows, cols);
+            ++bad;
+        }
+        if (safe >= 0) {
+            int v = field_count(f, safe);
+            field_set_count(f, safe, (v + 1) % 9);
+            if (validate_field_ex(f, false)) {
+                fprintf(stderr, "  валидатор: поле %dx%d, испорченная клетка (%d, %d) не найдена\n",
+                    rows, cols, safe / cols, safe % cols);
+                ++bad;
+            }
+            field_set_count(f, safe, v);
+        }
+        field_free(f);
+    }
+    printf("счётчики (%s) против эталона: полей %d, клеток %ld, расхождений %ld\n",
+        simd_name(), SELFTEST_COUNTS_BOARDS, cells, bad);
+    return bad;
+}
+
+/* selftest_bands — сверка полос с последовательным солвером (см. выше); возвращает число расхождений. */
+static long selftest_bands(Rng* g) {
+    bool pair_rules = solver_pair_rules_default;
+    long runs = 0, bad = 0;
+    for (int k = 0; k < SELFTEST_BANDS_BOARDS; ++k) {
+        int rows = PAR_MIN_BAND_ROWS * (3 + (int)rng_below(g, 2)) + (int)rng_below(g, 16);
+        int cols = 1 + (int)rng_below(g, 64), threads = 2 + (int)rng_below(g, 3);
+        solver_pair_rules_default = k % 2 == 1;
+        Field* f = field_create(rows, cols);
+        SolverCtx* s = f ? solver_ctx_create(rows, cols) : NULL;
+        SolverCtx* t = s ? solver_ctx_create(rows, cols) : NULL;
+        if (!t) { solver_ctx_free(s); field_free(f); ++bad; continue; }
+        generate_by_probability(f, (double)(5 + rng_below(g, 20)), g);
+        solver_ctx_bind(s, f);
+        solver_ctx_bind(t, f);
+        for (int j = 0; j < SELFTEST_BANDS_STARTS; ++j) {
+            int i = (int)rng_below(g, (uint64_t)rows * cols);
+            if (field_mine(f, i)) continue;
+            bool seq = solver_ctx_run(s, f, i);
+            bool par = solver_bands_run(t, f, i, threads);
+            bool same = seq == par && s->opened == t->opened;
+            for (int q = 0; q < s->pn && same; ++q)
+                same = !bit_get(s->open, q) == !bit_get(t->open, q);
+            ++runs;
+            if (!same) {
+                if (bad < 5)
+                    fprintf(stderr, "  полосы: поле %dx%d, %d потока, правило C %s, старт (%d, %d): "
+                        "%d открытых вместо %d\n", rows, cols, threads,
+                        solver_pair_rules_default ? "вкл" : "выкл", i / cols, i % cols, t->opened, s->opened);
+                ++bad;
+            }
+        }
+        solver_ctx_free(t);
+        solver_ctx_free(s);
+        field_free(f);
+    }
+    solver_pair_rules_default = pair_rules;
+    printf("полосы против солвера в одном потоке: полей %d, запусков %ld, расхождений %ld\n",
+        SELFTEST_BANDS_BOARDS, runs, bad);
+    return bad;
+}
+
+/* run_selftest — все проверки; возвращает код завершения. */
+int run_selftest(int argc, char** argv) {
+    long long seed = 20240601;
+    if (argc > 3 || (argc == 3 && !parse_long_arg(argv[2], &seed))) {
+        fprintf(stderr, "Использование: %s --selftest [SEED]\n", argv[0]);
+        return 2;
+    }
+    Rng g;
+    rng_seed(&g, (uint64_t)seed);
+    long bad = 0;
+    bad += selftest_solver(&g);
+    bad += selftest_counts(&g);
+    bad += selftest_bands(&g);
+    printf(bad == 0 ? "Самопроверка пройдена.\n" : "Самопроверка НЕ пройдена.\n");
+    return bad == 0 ? 0 : 1;
 }
 
 /* ===================================================================
    Основной цикл программы и пользовательский интерфейс
    =================================================================== */
 
-int main(void) {
+int main(int argc, char** argv) {
     setlocale(LC_ALL, "Rus");
-    /* инициализация RNG */
-    srand((unsigned)time(NULL));
+
+    /* общие ключи перед режимом:
+         --pair-rules       — солвер с правилом C (пары чисел) поверх A и B;
+         --basic-rules      — солвер только с правилами A и B (по умолчанию);
+         --repair           — генерация с исправлениями вместо новых попыток;
+         --rate-table FILE  — таблица долей решаемых полей между запусками;
+         --start R C        — первое открытие в клетке (R, C): безопасное окно 3x3
+                              и один запуск солвера на попытку (важнее --repair) */
+    while (argc > 1 && (strcmp(argv[1], "--basic-rules") == 0 || strcmp(argv[1], "--pair-rules") == 0 ||
+        strcmp(argv[1], "--repair") == 0 ||
+        (strcmp(argv[1], "--rate-table") == 0 && argc > 2) || (strcmp(argv[1], "--start") == 0 && argc > 3))) {
+        if (strcmp(argv[1], "--start") == 0) {
+            long long sr, sc;
+            if (!parse_long_arg(argv[2], &sr) || !parse_long_arg(argv[3], &sc) ||
+                sr < 0 || sr >= INT32_MAX || sc < 0 || sc >= INT32_MAX) {
+                fprintf(stderr, "Неверная стартовая клетка: %s %s\n", argv[2], argv[3]);
+                return 2;
+            }
+            gen_start_r = (int)sr;
+            gen_start_c = (int)sc;
+            argv[3] = argv[0];
+            argv += 3;
+            argc -= 3;
+            continue;
+        }
+        if (strcmp(argv[1], "--rate-table") == 0) {
+            if (!rate_table_load(&rate_table, argv[2])) {
+                fprintf(stderr, "Неверный формат таблицы %s\n", argv[2]);
+                return 2;
+            }
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+            continue;
+        }
+        if (strcmp(argv[1], "--repair") == 0) gen_repair_mode = true;
+        else solver_pair_rules_default = strcmp(argv[1], "--pair-rules") == 0;
+        argv[1] = argv[0];
+        ++argv;
+        --argc;
+    }
+
+    /* неинтерактивные режимы */
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) return run_batch(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0) return run_serve(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--convert") == 0) return run_convert(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--stream") == 0) return run_stream(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--view") == 0) return run_view(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--validate") == 0) return run_validate(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--solve") == 0) return run_solve(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) return run_bench(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--selftest") == 0) return run_selftest(argc, argv);
+    /* источник начальных значений: у каждой генерации свой master_seed */
+    Rng seeds;
+    rng_seed(&seeds, (uint64_t)time(NULL));
+    int threads = cpu_count(); /* число потоков генерации */
 
     printf("Здравствуйте! Это генератор поля Сапёр (Mines generator).\n");
 
     for (;;) { /* внешний бесконечный цикл: после сохранения или отказа можно начать заново */
-        int rows = 8, cols = 8, perc = 15;
+        int rows = 8, cols = 8;
+        double perc = 15;
+        int exact_mines = -1; /* >= 0 — задано точное число мин */
+        uint64_t user_seed = 0;
+        bool has_seed = false; /* seed задан пользователем — первая генерация его воспроизводит */
 
         /* ---------- Ввод размеров поля ---------- */
         printf("\nВведите размеры поля (строки столбцы), например: 8 8\n");
@@ -460,16 +5295,26 @@ int main(void) {
         }
         while (getchar() != '\n'); // очистка остатка ввода
 
-        /* ---------- Ввод вероятности мин ---------- */
-        printf("Введите вероятность заполнения минами (0..100), например: 15\n");
-        if (scanf("%d", &perc) != 1 || perc < 0 || perc > 100) {
-            printf("Ввод некорректен. Установлено 15%%.\n");
-            perc = 15;
+        /* ---------- Ввод вероятности мин (и необязательного seed) ---------- */
+        printf("Введите вероятность заполнения минами (0..100), например: 15 или 15.5,\n"
+            "или точное число мин с суффиксом m, например: 99m\n");
+        printf("Чтобы повторить поле, укажите через пробел его seed, например: 15 123456789\n");
+        {
+            char line[128], dens[32];
+            int got = 0;
+            if (fgets(line, sizeof(line), stdin))
+                got = sscanf(line, "%31s %" SCNu64, dens, &user_seed);
+            if (got < 1 || !parse_density_arg(dens, (long long)rows * cols, &perc, &exact_mines)) {
+                printf("Ввод некорректен. Установлено 15%%.\n");
+                perc = 15;
+                exact_mines = -1;
+                got = 0;
+            }
+            has_seed = (got == 2);
         }
-        while (getchar() != '\n');
 
         /* Создаём поле нужного размера */
-        Field* field = field_create(rows, cols);
+        Field* field = field_create_ex(rows, cols, (long long)rows * cols >= PACKED_MIN_CELLS);
         if (!field) { printf("Ошибка выделения памяти.\n"); return 1; }
 
     generate_again:
@@ -485,28 +5330,67 @@ int main(void) {
                параметрами (rows,cols,perc) найти решаемое поле быстро не получилось.
                В этом случае даём пользователю выбор: перегенерировать / ввести новые параметры / выйти.
                Примечание: MAX_ATTEMPTS — практический предел, а не теоретическая граница.
+               Попытки выполняются параллельно на всех ядрах (generate_solvable_parallel).
+               Бюджет адаптивный: по наблюдаемой доле решаемых полей попытки
+               прекращаются раньше, если успех очень маловероятен (см. GenBudget).
             */
-            for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
-                generate_by_probability(field, perc);
-                if (check_solvability(field, &start_r, &start_c)) {
-                    solvable = true; /* нашли подходящее поле */
-                    break;
-                }
+            int attempts = 0;
+            uint64_t master_seed = has_seed ? user_seed : rng_next(&seeds);
+            bool replay = has_seed;
+            has_seed = false; /* повторная генерация (R) даёт новое поле */
+
+            /* стартовая клетка (--start): доля решаемых при одном запуске из неё
+               другая и зависит от самой клетки, поэтому таблица долей и бюджет
+               в этом режиме не ведутся (--pair-rules и --repair — часть ключа таблицы) */
+            bool anchored = gen_start_r >= 0;
+            if (anchored && (gen_start_r >= rows || gen_start_c >= cols)) {
+                printf("Стартовая клетка (%d, %d) вне поля %dx%d — ищется любая подходящая.\n",
+                    gen_start_r, gen_start_c, rows, cols);
+                anchored = false;
             }
+            bool budgeted = !replay && !anchored;
+
+            GenBudget budget;
+            int rate_mode = gen_rate_mode(); /* --pair-rules и --repair ведут свои записи */
+            gen_budget_prepare(&budget, &rate_table, rows, cols, perc, exact_mines, rate_mode);
+            if (budgeted && budget.prior_solved > 0)
+                printf("Доля решаемых полей при этих параметрах ~ %.1f%% (по %lld попыткам), "
+                    "ожидается ~ %.0f попыток\n", 100.0 * budget.prior_solved / budget.prior_trials,
+                    budget.prior_trials, (double)budget.prior_trials / budget.prior_solved);
+            solvable = generate_solvable_parallel(field, perc, exact_mines, master_seed, threads,
+                MAX_ATTEMPTS, &start_r, &start_c, &attempts, budgeted ? &budget : NULL);
+            if (budgeted) rate_table_record(&rate_table, rows, cols, perc, exact_mines, rate_mode, &budget);
 
             /* Показываем информацию о сгенерированном поле */
-            printf("\nСгенерировано поле %dx%d, вероятность %d%%, мин = %d\n",
-                field->rows, field->cols, perc, field->mines);
+            if (exact_mines >= 0)
+                printf("\nСгенерировано поле %dx%d, мин = %d (точно), попыток = %d\n",
+                    field->rows, field->cols, field->mines, attempts);
+            else
+                printf("\nСгенерировано поле %dx%d, вероятность %g%%, мин = %d, попыток = %d\n",
+                    field->rows, field->cols, perc, field->mines, attempts);
+            printf("seed = %" PRIu64 " (введите его вместе с вероятностью, чтобы повторить поле)\n",
+                master_seed);
+#ifdef MS_STATS
+            {
+                SolverStats st = stats_take();
+                stats_print(stdout, &st);
+            }
+#endif
 
             if (!solvable) {
                 /* Если не нашли решаемое поле */
                 printf("Поле НЕ решаемо детерминистическим солвером.\n");
+                if (budgeted && budget.gave_up) {
+                    double hi = gen_budget_rate_hi(&budget, budget.trials);
+                    printf("Генерация остановлена досрочно: с 95%% уверенностью решаемых полей не больше %.3f%%,\n"
+                        "то есть понадобилось бы не меньше %.0f попыток.\n", 100.0 * hi, 1.0 / hi);
+                }
 
                 printf("Показать текущее поле для анализа? (Y/N): ");
                 int ch = getchar();
                 while (getchar() != '\n');
 
-                if (ch == 'Y' || ch == 'y') print_field_ascii(field, true);
+                if (ch == 'Y' || ch == 'y') show_field(field);
 
                 printf("Поле не решаемо. Выберите: (R) сгенерировать заново, (P) ввести новые параметры, (E) выйти\n");
                 int opt = getchar();
@@ -529,7 +5413,7 @@ int main(void) {
             else {
                 /* Если поле оказалось решаемо — сообщаем и показываем поле. */
                 printf("Поле решаемо детерминистическим солвером.\n", start_r, start_c);
-                print_field_ascii(field, true);
+                show_field(field);
 
                 /* ---------------- Меню после успешной генерации ---------------- */
                 printf("\n(Y) выполнить автоматическую проверку счётчиков и сохранить поле, (R) перегенерировать, (P) новые параметры, (E) выйти\n");
@@ -566,17 +5450,30 @@ int main(void) {
                     else {
                         /* Сохранение поля */
                         char fname[260];
-                        printf("Введите имя файла для сохранения (например field.txt): ");
+                        printf("Введите имя файла для сохранения (например field.txt; .msb — двоичный формат): ");
                         if (scanf("%259s", fname) == 1) {
-                            if (save_field_to_file(field, fname)) {
+                            size_t len = strlen(fname);
+                            bool binary = len > 4 && strcmp(fname + len - 4, ".msb") == 0;
+                            /* к текстовому полю дописывается его сложность (score_board) */
+                            BoardScore score;
+                            ScoreCtx* sc = binary ? NULL : score_ctx_create(field->rows, field->cols);
+                            bool scored = sc && score_board(sc, field, IDX(field, start_r, start_c), &score);
+                            score_ctx_free(sc);
+                            bool saved = binary ? save_field_binary(field, fname, master_seed, true)
+                                : save_field_with_score(field, fname, scored ? &score : NULL);
+                            if (saved) {
                                 printf("Поле успешно сохранено в %s\n", fname);
+                                if (scored)
+                                    printf("Сложность: ярус правил %d, раундов %d, наибольший фронт %d, "
+                                        "наибольшая перебранная компонента %d\n",
+                                        score.tier, score.rounds, score.max_frontier, score.max_component);
                             }
                             else {
                                 printf("Ошибка при сохранении в %s\n", fname);
                             }
                         }
                         while (getchar() != '\n'); // очистка ввода
-                        print_field_ascii(field, true);
+                        show_field(field);
 
                         /* Меню после сохранения: /новое поле / выход */
                         for (;;) {